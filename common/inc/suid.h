@@ -5,6 +5,8 @@
 
 #pragma once
 #include <cstdint>
+#include <cstddef>
+#include <functional>
 namespace com {
 namespace quic {
 namespace sensinghub {
@@ -24,9 +26,40 @@ struct suid
   {
     return !(*this == rhs);
   }
+  bool operator<(const suid& rhs) const
+  {
+    return (high < rhs.high || (high == rhs.high && low < rhs.low));
+  }
   uint64_t low, high;
 };
 
 }  // namespace sensinghub
 }  // namespace quic
 }  // namespace com
+
+namespace std {
+
+/*
+ * @brief Allocation-free hash for suid
+ *
+ * SUIDs are mostly random already, but both halves are folded and run
+ * through a 64-bit finalizer so that structured SUIDs (e.g. a counter
+ * in one half) still spread over all bits, which open-addressing
+ * tables masking the low bits rely on.
+ */
+template<>
+struct hash<com::quic::sensinghub::suid>
+{
+  size_t operator()(const com::quic::sensinghub::suid& uid) const noexcept
+  {
+    uint64_t h = uid.low ^ (((uid.high << 32) | (uid.high >> 32)) * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+};
+
+}  // namespace std
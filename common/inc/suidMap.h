@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "suid.h"
+
+namespace com {
+namespace quic {
+namespace sensinghub {
+
+/*
+ * @brief Open-addressing hash map keyed by suid
+ *
+ * Entries live in one contiguous array and collisions are resolved by
+ * linear probing, so a lookup touches one or two cache lines and never
+ * allocates. Erase uses backward-shift deletion, which keeps probe
+ * sequences short without tombstones.
+ *
+ * The value type must be default constructible and movable. Pointers
+ * and iterators are invalidated by insert (on growth) and erase.
+ * Not thread-safe.
+ */
+template<typename V>
+class suidFlatMap
+{
+public:
+  using value_type = std::pair<suid, V>;
+
+  class iterator
+  {
+  public:
+    iterator(suidFlatMap* map, size_t idx) : mMap(map), mIdx(idx) { skip(); }
+    value_type& operator*() const { return mMap->mSlots[mIdx]; }
+    value_type* operator->() const { return &mMap->mSlots[mIdx]; }
+    iterator& operator++() { mIdx++; skip(); return *this; }
+    bool operator==(const iterator& rhs) const { return mIdx == rhs.mIdx; }
+    bool operator!=(const iterator& rhs) const { return mIdx != rhs.mIdx; }
+  private:
+    void skip()
+    {
+      while (mIdx < mMap->mUsed.size() && !mMap->mUsed[mIdx]) {
+        mIdx++;
+      }
+    }
+    suidFlatMap* mMap;
+    size_t mIdx;
+  };
+
+  suidFlatMap() = default;
+
+  /*
+   * @brief find the value stored for a suid
+   * @return pointer to the value, nullptr if not present
+   */
+  V* find(const suid& key)
+  {
+    if (0 == mSize) {
+      return nullptr;
+    }
+    for (size_t idx = home(key); mUsed[idx]; idx = (idx + 1) & mMask) {
+      if (mSlots[idx].first == key) {
+        return &mSlots[idx].second;
+      }
+    }
+    return nullptr;
+  }
+
+  const V* find(const suid& key) const
+  {
+    return const_cast<suidFlatMap*>(this)->find(key);
+  }
+
+  bool contains(const suid& key) const { return nullptr != find(key); }
+
+  /*
+   * @brief insert a value if the suid is not present yet
+   * @return pointer to the stored value and true if it was inserted,
+   *         false if the suid was already present
+   */
+  std::pair<V*, bool> insert(const suid& key, V value)
+  {
+    V* existing = find(key);
+    if (nullptr != existing) {
+      return {existing, false};
+    }
+    if ((mSize + 1) * 4 > mSlots.size() * 3) {
+      rehash(mSlots.empty() ? MIN_CAPACITY : mSlots.size() * 2);
+    }
+    size_t idx = home(key);
+    while (mUsed[idx]) {
+      idx = (idx + 1) & mMask;
+    }
+    mSlots[idx].first = key;
+    mSlots[idx].second = std::move(value);
+    mUsed[idx] = 1;
+    mSize++;
+    return {&mSlots[idx].second, true};
+  }
+
+  /*
+   * @brief get the value of a suid, default-inserting it if absent
+   */
+  V& operator[](const suid& key)
+  {
+    return *insert(key, V()).first;
+  }
+
+  /*
+   * @brief remove a suid
+   * @return true if the suid was present
+   */
+  bool erase(const suid& key)
+  {
+    if (0 == mSize) {
+      return false;
+    }
+    size_t idx = home(key);
+    while (mUsed[idx] && mSlots[idx].first != key) {
+      idx = (idx + 1) & mMask;
+    }
+    if (!mUsed[idx]) {
+      return false;
+    }
+    /* shift back the following entries of the cluster that would
+       become unreachable through the hole */
+    size_t hole = idx;
+    for (size_t next = (hole + 1) & mMask; mUsed[next]; next = (next + 1) & mMask) {
+      size_t want = home(mSlots[next].first);
+      if (((next - want) & mMask) >= ((next - hole) & mMask)) {
+        mSlots[hole] = std::move(mSlots[next]);
+        hole = next;
+      }
+    }
+    mSlots[hole] = value_type();
+    mUsed[hole] = 0;
+    mSize--;
+    return true;
+  }
+
+  void reserve(size_t count)
+  {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity * 3 < count * 4) {
+      capacity *= 2;
+    }
+    if (capacity > mSlots.size()) {
+      rehash(capacity);
+    }
+  }
+
+  void clear()
+  {
+    mSlots.assign(mSlots.size(), value_type());
+    mUsed.assign(mUsed.size(), 0);
+    mSize = 0;
+  }
+
+  size_t size() const { return mSize; }
+  bool empty() const { return 0 == mSize; }
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, mUsed.size()); }
+
+private:
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  size_t home(const suid& key) const
+  {
+    return std::hash<suid>()(key) & mMask;
+  }
+
+  void rehash(size_t capacity)
+  {
+    std::vector<value_type> slots(capacity);
+    std::vector<uint8_t> used(capacity, 0);
+    mSlots.swap(slots);
+    mUsed.swap(used);
+    mMask = capacity - 1;
+    mSize = 0;
+    for (size_t idx = 0; idx < used.size(); idx++) {
+      if (used[idx]) {
+        insert(slots[idx].first, std::move(slots[idx].second));
+      }
+    }
+  }
+
+  std::vector<value_type> mSlots;
+  std::vector<uint8_t> mUsed;
+  size_t mMask = 0;
+  size_t mSize = 0;
+};
+
+/*
+ * @brief Sorted-vector map keyed by suid
+ *
+ * Entries are kept ordered in one contiguous array and looked up by
+ * binary search. Insert and erase are O(n), which makes this the better
+ * choice for small, read-mostly tables (e.g. the handful of SUIDs a
+ * session is registered for) where iteration order must be stable.
+ *
+ * Pointers and iterators are invalidated by insert and erase.
+ * Not thread-safe.
+ */
+template<typename V>
+class suidSortedMap
+{
+public:
+  using value_type = std::pair<suid, V>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  V* find(const suid& key)
+  {
+    auto it = lowerBound(key);
+    return (it != mEntries.end() && it->first == key) ? &it->second : nullptr;
+  }
+
+  const V* find(const suid& key) const
+  {
+    return const_cast<suidSortedMap*>(this)->find(key);
+  }
+
+  bool contains(const suid& key) const { return nullptr != find(key); }
+
+  std::pair<V*, bool> insert(const suid& key, V value)
+  {
+    auto it = lowerBound(key);
+    if (it != mEntries.end() && it->first == key) {
+      return {&it->second, false};
+    }
+    it = mEntries.insert(it, value_type(key, std::move(value)));
+    return {&it->second, true};
+  }
+
+  V& operator[](const suid& key)
+  {
+    return *insert(key, V()).first;
+  }
+
+  bool erase(const suid& key)
+  {
+    auto it = lowerBound(key);
+    if (it == mEntries.end() || it->first != key) {
+      return false;
+    }
+    mEntries.erase(it);
+    return true;
+  }
+
+  void reserve(size_t count) { mEntries.reserve(count); }
+  void clear() { mEntries.clear(); }
+  size_t size() const { return mEntries.size(); }
+  bool empty() const { return mEntries.empty(); }
+  iterator begin() { return mEntries.begin(); }
+  iterator end() { return mEntries.end(); }
+  const_iterator begin() const { return mEntries.begin(); }
+  const_iterator end() const { return mEntries.end(); }
+
+private:
+  iterator lowerBound(const suid& key)
+  {
+    return std::lower_bound(mEntries.begin(), mEntries.end(), key,
+        [](const value_type& entry, const suid& k) { return entry.first < k; });
+  }
+
+  std::vector<value_type> mEntries;
+};
+
+}  // namespace sensinghub
+}  // namespace quic
+}  // namespace com
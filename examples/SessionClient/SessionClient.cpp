@@ -38,6 +38,12 @@ extern "C" {
 
 #include "ISession.h"
 #include "SessionFactory.h"
+#include "qshCoSession.h"
+/* getAttributes() runs on qshCoSession in C++20 builds with USE_COROUTINES */
+#if defined(USE_COROUTINES) && defined(QSH_HAS_COROUTINES)
+#define SESSIONCLIENT_COROUTINES 1
+#include <future>
+#endif
 
 using namespace std;
 using namespace ::com::quic::sensinghub::session::V1_0;
@@ -496,6 +502,109 @@ bool decode_attribute_event(pb_istream_t *stream, const pb_field_t *field,
   return rv;
 }
 
+#ifdef SESSIONCLIENT_COROUTINES
+/*=============================================================================
+     FUNCTION :  fetchAttributes
+=============================================================================*/
+/*!
+@brief
+  This coroutine fetches the attributes of all suids for required sensorType.
+  Each request is awaited until its attribute event is received, no thread
+  is blocked in the meantime.
+*/
+qshCoTask<bool> fetchAttributes(qshCoSession& attributeSession){
+  /* open the attributeSession session */
+  if(0 != co_await attributeSession.open()){
+    printf("failed to open ISession for attribute query");
+    co_return false;
+  }
+
+  for (const suid& uid : suidList) {
+    printf("\nrequesting attributes for - suid_low=%" PRIu64 " suid_high=%" PRIu64 "\n", uid.low, uid.high);
+
+    /* create pb-encoded config request message to be sent for attribute query */
+    sns_client_request_msg request_msg = sns_client_request_msg_init_default;
+    sns_std_suid _suid = {.suid_low = uid.low, .suid_high = uid.high};
+    request_msg.suid = _suid;
+    request_msg.msg_id = SNS_STD_MSGID_SNS_STD_ATTR_REQ;
+    request_msg.susp_config.client_proc_type = SNS_STD_CLIENT_PROCESSOR_APSS;
+    request_msg.susp_config.delivery_type = SNS_CLIENT_DELIVERY_WAKEUP;
+    request_msg.request.payload.funcs.encode = NULL;
+
+    pb_byte_t buffer[256];
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+    if (!pb_encode(&stream, sns_client_request_msg_fields, &request_msg)) {
+        printf("ATTR_REQ Failed to encode: %s\n", PB_GET_ERROR(&stream));
+        co_return false;
+    }
+    printf("ATTR_REQ Encoded successfully (%zu bytes)\n", stream.bytes_written);
+    std::string encoded_string(reinterpret_cast<char*>(buffer), stream.bytes_written);
+
+    /* send proto encoded message and wait for its response */
+    qshCoResponse resp = co_await attributeSession.sendRequest(uid, std::move(encoded_string));
+    if(!resp.received){
+        printf("Error in sending attribute query request");
+        co_return false;
+    }
+    cout<<"\nAttribute query response received.";
+
+    /* wait for the attribute event of this suid */
+    qshCoEvent event = co_await attributeSession.nextEvent(uid);
+    if(!event.valid){
+        printf("session failed before attributes were received");
+        co_return false;
+    }
+    printf("got attribute event \n");
+    sns_client_event_msg pb_event_msg = sns_client_event_msg_init_default;
+    pb_istream_t event_stream = pb_istream_from_buffer((const pb_byte_t *) event.data.data(),
+                                                       static_cast<pb_size_t>(event.data.size()));
+    pb_event_msg.events.funcs.decode = &decode_attribute_event; // called for each event
+    pb_event_msg.events.arg = NULL;
+    if (!pb_decode(&event_stream, sns_client_event_msg_fields, &pb_event_msg)){
+        printf("retrieve_attributes decoding failed \n");
+    }
+  }
+  co_return true;
+}
+
+/*=============================================================================
+     FUNCTION :  runFetchAttributes
+=============================================================================*/
+/*!
+@brief
+  Top-level coroutine handing the result of fetchAttributes over to main.
+*/
+qshCoTask<> runFetchAttributes(qshCoSession& attributeSession, std::promise<bool>& result){
+  result.set_value(co_await fetchAttributes(attributeSession));
+}
+
+/*=============================================================================
+     FUNCTION :  getAttributes
+=============================================================================*/
+/*!
+@brief
+  This function fetches the attributes of all suids for required sensorType,
+  using the coroutine front-end of ISession.
+*/
+bool getAttributes(){
+  /* the coroutines run on the thread of this worker */
+  qshWorker worker;
+  qshCoExecutor executor(worker);
+  qshCoSession attributeSession;
+  std::promise<bool> result;
+  std::future<bool> done = result.get_future();
+
+  qshCoSpawn(executor, runFetchAttributes(attributeSession, result));
+  bool ret = done.get();
+
+  /* close the session once all attributes are received */
+  attributeSession.close();
+  if (ret) {
+    printf("\nAttributes for all suids received\n");
+  }
+  return ret;
+}
+#else
 /*=============================================================================
      FUNCTION :  getAttributes
 =============================================================================*/
@@ -608,6 +717,7 @@ bool getAttributes(){
   printf("\nAttributes for all suids received\n");
   return true;
 }
+#endif /* SESSIONCLIENT_COROUTINES */
 
 /*=============================================================================
      FUNCTION :  decode_client_event_msg
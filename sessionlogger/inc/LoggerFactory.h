@@ -93,23 +93,12 @@ public:
   static void updateDataType(const suid& sensorUid, const std::string& datatype);
 
 private:
-  /** Hash functor for suid. */
-  struct SuidHash {
-    std::size_t operator()(const suid& sensorUid) const {
-      std::string data(reinterpret_cast<const char*>(&sensorUid), sizeof(suid));
-      return std::hash<std::string>()(data);
-    }
-  };
-
-  /** Equality functor for suid. */
-  struct SuidEq {
-    bool operator()(const suid& a, const suid& b) const {
-      return a.low == b.low && a.high == b.high;
-    }
-  };
-
-  /** Suid - Sensor DataType cache. */
-  static std::unordered_map<suid, std::string, SuidHash, SuidEq> sDtCache;
+  /**
+   * Suid - Sensor DataType cache. Kept node-based (rather than a flat
+   * suid map) because getDataType() hands out pointers into the stored
+   * strings, which must survive later insertions.
+   */
+  static std::unordered_map<suid, std::string> sDtCache;
 
   /** Private mutex for cache interactions. */
   static std::mutex sDtMutex;
@@ -20,8 +20,7 @@ namespace V1_0 {
 
 
 std::mutex LoggerFactory::sDtMutex;
-std::unordered_map<suid, std::string, LoggerFactory::SuidHash, LoggerFactory::SuidEq>
-    LoggerFactory::sDtCache = {
+std::unordered_map<suid, std::string> LoggerFactory::sDtCache = {
         // SUID sensor fixed suid used by SSC for SUID lookup.
         {{0xababababababababULL, 0xababababababababULL}, "suid"}
     };
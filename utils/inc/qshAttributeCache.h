@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "ISession.h"
+#include "SessionFactory.h"
+#include "suidMap.h"
+#include "qshPbSensorUtils.h"
+
+using suid = com::quic::sensinghub::suid;
+
+using com::quic::sensinghub::session::V1_0::ISession;
+using com::quic::sensinghub::session::V1_0::sessionFactory;
+
+/**
+ * @brief Lazy, per-sensor attribute cache
+ *
+ * Attributes of a sensor are requested from the hub only when they
+ * are accessed for the first time. Concurrent accesses for the same
+ * suid share a single attribute request, and the decoded result is
+ * kept for the lifetime of the cache, so subsequent accesses are
+ * served locally.
+ *
+ * One qshAttributeCache owns a single session to the hub, which is
+ * shared by all sensors fetched through it.
+ */
+class qshAttributeCache
+{
+public:
+    /**
+     * @brief creates a new connection to qsh for attribute queries
+     *
+     * @param hubId sensor hub ID to query. Use -1 for default hub
+     */
+    qshAttributeCache(int hubId = -1);
+    ~qshAttributeCache();
+
+    /**
+     * @brief get all attributes of a sensor, fetching them from the
+     *        hub on first access
+     *
+     * If an attribute request for this suid is already in flight,
+     * the caller waits for that request instead of issuing a new one.
+     *
+     * @param sensorUid suid of the sensor
+     * @param attrs filled with the decoded attributes on success
+     * @param timeoutMs maximum time to wait for the attribute event
+     *
+     * @return true if the attributes are available, false on
+     *         timeout or if the request could not be sent
+     *
+     * @warning This method blocks the calling thread on cache miss
+     */
+    bool getAttributes(const suid& sensorUid, qshPb::sensor_attributes& attrs,
+        std::chrono::milliseconds timeoutMs = DEFAULT_ATTR_TIMEOUT);
+
+    /**
+     * @brief get the values of a single attribute of a sensor,
+     *        fetching the sensor's attributes on first access
+     *
+     * @param sensorUid suid of the sensor
+     * @param attrId attribute ID (sns_std_sensor_attr_id)
+     * @param values filled with the attribute values on success
+     * @param timeoutMs maximum time to wait for the attribute event
+     *
+     * @return true if the sensor publishes this attribute, false
+     *         otherwise or on timeout
+     */
+    bool getAttribute(const suid& sensorUid, int32_t attrId, qshPb::attributes& values,
+        std::chrono::milliseconds timeoutMs = DEFAULT_ATTR_TIMEOUT);
+
+    /**
+     * @brief get the attributes of a sensor known so far, without
+     *        blocking and without sending any request
+     *
+     * @param sensorUid suid of the sensor
+     * @param attrs filled with the currently known attributes
+     *
+     * @return true if the attribute event for this sensor has been
+     *         received completely, false if attrs is empty or partial
+     */
+    bool getKnownAttributes(const suid& sensorUid, qshPb::sensor_attributes& attrs);
+
+    /**
+     * @brief send the attribute request for a sensor without waiting
+     *        for the result. No-op if the attributes are cached or
+     *        already requested.
+     *
+     * @param sensorUid suid of the sensor
+     */
+    void prefetch(const suid& sensorUid);
+
+    /**
+     * @brief drop the cached attributes of a sensor, the next access
+     *        fetches them again from the hub
+     *
+     * @param sensorUid suid of the sensor
+     */
+    void invalidate(const suid& sensorUid);
+
+private:
+    static constexpr auto DEFAULT_ATTR_TIMEOUT = std::chrono::milliseconds(1000);
+
+    enum class fetchState {
+        IDLE,       /* attributes never requested, or last request timed out
+                       for all its waiters */
+        PENDING,    /* attribute request sent, waiting for the event */
+        READY       /* attribute event received and decoded */
+    };
+
+    struct attrEntry {
+        fetchState state = fetchState::IDLE;
+        bool callbacksSet = false;
+        /* bumped by every new request and by invalidate() */
+        uint64_t generation = 0;
+        /* callers waiting for the current request */
+        uint32_t waiters = 0;
+        qshPb::sensor_attributes attrs;
+    };
+
+    /* marks the entry pending and sends the attribute request if no
+       request is in flight; lk is released while talking to the hub */
+    void fetch(std::unique_lock<std::mutex>& lk, const suid& sensorUid);
+    bool sendAttrRequest(const suid& sensorUid, bool setCallBacks);
+    bool waitReady(std::unique_lock<std::mutex>& lk, const suid& sensorUid,
+        std::chrono::milliseconds timeoutMs);
+    void handleQshEvent(const suid& sensorUid, const uint8_t *data, size_t size);
+
+    std::unique_ptr<ISession> mSession = nullptr;
+    std::unique_ptr<sessionFactory> mSessionFactory = nullptr;
+    com::quic::sensinghub::suidFlatMap<attrEntry> mEntries;
+    std::mutex mMutex;
+    std::condition_variable mConditionVar;
+};
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ISession.h"
+#include "suidMap.h"
+#include "qshLatencyMonitor.h"
+#include "qshPb.h"
+#include "qshTimeUtil.h"
+
+using suid = com::quic::sensinghub::suid;
+
+using com::quic::sensinghub::session::V1_0::ISession;
+
+/**
+ * @brief Hub-side latency of a generic direct channel, with the
+ *        host-side latency of the same stream when available
+ */
+struct qshChannelLatencySnapshot
+{
+    suid sensorUid;
+    uint64_t reports = 0;           /* latency messages received */
+    /* all reports since the channel was first seen */
+    uint64_t samples = 0;
+    uint32_t avgLatencyUs = 0;
+    uint32_t maxLatencyUs = 0;
+    uint64_t maxLatencyTs = 0;      /* timestamp of the worst sample, ns */
+    /* reports received within the rolling window */
+    uint64_t windowSamples = 0;
+    uint32_t windowAvgLatencyUs = 0;
+    uint32_t windowMaxLatencyUs = 0;
+    /* host side, from qshLatencyMonitor */
+    bool hasHost = false;
+    qshLatencySnapshot host;
+};
+
+/**
+ * @brief Collects the sns_generic_channel_latency_msg reports of
+ *        generic direct channels
+ *
+ * The hub reports, for each generic channel, the average and maximum
+ * latency from sample measurement to the write into the channel
+ * buffer. Reports are decoded in place from the event buffer, without
+ * allocation, and aggregated per stream suid over all time and over a
+ * rolling window of WINDOW_SLOTS slots of SLOT_NS.
+ *
+ * Snapshots can be joined with the qshLatencyMonitor of the host side
+ * for an end-to-end breakdown of the latency.
+ *
+ * Generic channels are created by the client owning the channel
+ * buffer, not by this library, and the hub sends their latency
+ * reports as events of the channel's stream: the owner attaches the
+ * collector to each stream it opens, with wrapEventCallBack() on the
+ * stream's event callback, or handleEvent()/handleReport() when it
+ * reads the events itself. Channels attached through
+ * wrapEventCallBack() are listed from then on, also before their
+ * first report.
+ */
+class qshChannelLatency
+{
+public:
+    static constexpr size_t WINDOW_SLOTS = 12;
+    static constexpr uint64_t SLOT_NS = 5000000000ull;
+
+    explicit qshChannelLatency(qshTimeUtil& timeUtil = qshTimeUtil::getInstance());
+
+    qshChannelLatency(const qshChannelLatency&) = delete;
+    qshChannelLatency& operator=(const qshChannelLatency&) = delete;
+
+    /**
+     * @brief decode an encoded sns_client_event_msg and collect the
+     *        latency reports it carries
+     *
+     * @param sensorUid suid of the stream of the generic channel
+     *
+     * @return number of latency reports found
+     */
+    size_t handleEvent(const suid& sensorUid, const uint8_t* data, size_t size);
+
+    /**
+     * @brief collect one encoded sns_generic_channel_latency_msg, e.g.
+     *        read from the channel buffer
+     *
+     * @return false if the message could not be decoded
+     */
+    bool handleReport(const suid& sensorUid, const uint8_t* payload, size_t size);
+
+    /**
+     * @brief wrap the event callback of a generic channel stream to
+     *        collect its latency reports before handing events over
+     *
+     * The channel is listed in the snapshots from this call on.
+     */
+    ISession::eventCallBack wrapEventCallBack(const suid& sensorUid, ISession::eventCallBack cb);
+
+    /**
+     * @brief forget a channel, once its stream is closed
+     */
+    void removeChannel(const suid& sensorUid);
+
+    /**
+     * @brief get the latency of all channels seen so far
+     *
+     * @param host host-side latency to join, by suid, may be nullptr
+     */
+    std::vector<qshChannelLatencySnapshot> getSnapshots(qshLatencyMonitor* host = nullptr);
+
+    /**
+     * @brief forget all reports
+     */
+    void reset();
+
+    /**
+     * @brief write the latency of all channels to the log
+     */
+    void logStats(qshLatencyMonitor* host = nullptr);
+
+    /**
+     * @brief export the latency of all channels as CSV, one line per
+     *        channel after a header line. Hub latencies are in us, as
+     *        reported, host latencies in ns.
+     */
+    std::string exportCsv(qshLatencyMonitor* host = nullptr);
+
+private:
+    struct slot {
+        uint64_t index = 0;         /* SLOT_NS period the slot holds */
+        uint64_t samples = 0;
+        uint64_t latencySumUs = 0;  /* avg_latency * sample_count */
+        uint32_t maxLatencyUs = 0;
+    };
+
+    struct channel {
+        uint64_t reports = 0;
+        uint64_t samples = 0;
+        uint64_t latencySumUs = 0;
+        uint32_t maxLatencyUs = 0;
+        uint64_t maxLatencyTs = 0;
+        slot window[WINDOW_SLOTS];
+    };
+
+    struct report {
+        uint64_t sampleCount;
+        uint64_t maxLatencyTs;
+        uint32_t maxLatencyUs;
+        uint32_t avgLatencyUs;
+    };
+
+    /* context of the event decoding callbacks */
+    struct decodeContext {
+        qshChannelLatency* self;
+        const suid* sensorUid;
+        size_t reports;
+    };
+
+    static bool decodeEvent(pb_istream_t* stream, const pb_field_t* field, void** arg);
+    static bool decodeReport(const uint8_t* payload, size_t size, report& rep);
+
+    void addReport(const suid& sensorUid, const report& rep);
+
+    qshTimeUtil& mTimeUtil;
+    std::mutex mMutex;
+    com::quic::sensinghub::suidFlatMap<channel> mChannels;
+};
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#if defined(__aarch64__)
+#define TARGET_ARM64
+#elif defined(__arm__)
+#define TARGET_ARM
+#elif defined(__x86_64__) || defined(__i386__)
+#define TARGET_X86
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#include <cstdint>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <time.h>
+#include "qshLog.h"
+
+/**
+ * @brief hardware counters qshClockSource can read
+ */
+enum class qshClockSourceType
+{
+    AUTO,               /* best source available on this target */
+    ARM_GENERIC_TIMER,  /* ARM generic timer (QTimer), cntvct/cntfrq */
+    X86_TSC,            /* x86 invariant TSC, calibrated against CLOCK_MONOTONIC_RAW */
+    CLOCK_GETTIME,      /* clock_gettime(), 1 tick = 1 ns */
+};
+
+/**
+ * @brief Tick counter backing qshTimeUtil
+ *
+ * On the device, ticks are read from the ARM generic timer, which is
+ * the QTimer shared with the sensing hub. On hosts (replay and
+ * benchmark tools) the x86 TSC or clock_gettime() stand in for it, so
+ * the same tick and ns conversions run everywhere.
+ *
+ * With AUTO, the default, the QSH_CLOCK_SOURCE environment variable
+ * ("arm", "tsc" or "gettime") selects the source at run time, e.g. to
+ * force clock_gettime() on a host whose TSC is not invariant.
+ */
+class qshClockSource
+{
+public:
+    explicit qshClockSource(qshClockSourceType type = qshClockSourceType::AUTO)
+    {
+        if (qshClockSourceType::AUTO == type) {
+            type = fromEnv();
+        }
+        if (qshClockSourceType::AUTO == type) {
+            type = bestAvailable();
+        }
+        if (!init(type)) {
+            sns_loge("clock source %s not available, using %s", toString(type),
+                     toString(qshClockSourceType::CLOCK_GETTIME));
+            init(qshClockSourceType::CLOCK_GETTIME);
+        }
+        sns_logd("clock source %s, %" PRIu64 " Hz", toString(mType), mFreq);
+    }
+
+    /**
+     * @brief reads the current tick count
+     */
+    uint64_t getTicks() const
+    {
+        switch (mType) {
+#if defined(TARGET_ARM64) || defined(TARGET_ARM)
+        case qshClockSourceType::ARM_GENERIC_TIMER:
+            return readArmCounter();
+#endif
+#if defined(TARGET_X86)
+        case qshClockSourceType::X86_TSC:
+            return __rdtsc();
+#endif
+        default:
+            return readClockNs(GETTIME_CLOCK);
+        }
+    }
+
+    /**
+     * @brief tick frequency in Hz
+     */
+    uint64_t getFreq() const { return mFreq; }
+
+    qshClockSourceType getType() const { return mType; }
+
+    static const char* toString(qshClockSourceType type)
+    {
+        switch (type) {
+        case qshClockSourceType::ARM_GENERIC_TIMER:
+            return "arm";
+        case qshClockSourceType::X86_TSC:
+            return "tsc";
+        case qshClockSourceType::CLOCK_GETTIME:
+            return "gettime";
+        default:
+            return "auto";
+        }
+    }
+
+private:
+    static constexpr uint64_t NSEC_PER_SEC = 1000000000ull;
+    /* ticks of the fallback source keep counting in suspend, like the QTimer */
+#ifdef CLOCK_BOOTTIME
+    static constexpr clockid_t GETTIME_CLOCK = CLOCK_BOOTTIME;
+#else
+    static constexpr clockid_t GETTIME_CLOCK = CLOCK_MONOTONIC;
+#endif
+    /* TSC calibration length and number of paired reads per end point */
+    static constexpr uint64_t TSC_CALIBRATION_NS = 20000000ull;
+    static constexpr int TSC_CALIBRATION_READS = 16;
+
+    static uint64_t readClockNs(clockid_t clock)
+    {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return uint64_t(ts.tv_sec) * NSEC_PER_SEC + uint64_t(ts.tv_nsec);
+    }
+
+#if defined(TARGET_ARM64) || defined(TARGET_ARM)
+    static uint64_t readArmCounter()
+    {
+    #if defined(TARGET_ARM64)
+        unsigned long long val = 0;
+        asm volatile("mrs %0, cntvct_el0" : "=r" (val));
+        return val;
+    #else
+        uint64_t val;
+        unsigned long lsb = 0, msb = 0;
+        asm volatile("mrrc p15, 1, %[lsb], %[msb], c14"
+                     : [lsb] "=r" (lsb), [msb] "=r" (msb));
+        val = ((uint64_t)msb << 32) | lsb;
+        return val;
+    #endif
+    }
+
+    static uint64_t readArmFreq()
+    {
+    #if defined(TARGET_ARM64)
+        uint64_t val = 0;
+        asm volatile("mrs %0, cntfrq_el0" : "=r" (val));
+        return val;
+    #else
+        uint32_t val = 0;
+        asm volatile("mrc p15, 0, %[val], c14, c0, 0" : [val] "=r" (val));
+        return val;
+    #endif
+    }
+#endif
+
+#if defined(TARGET_X86)
+    static bool hasInvariantTsc()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        if (0 == __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return 0 != (edx & (1u << 8));
+    }
+
+    /* TSC and CLOCK_MONOTONIC_RAW read as close together as possible */
+    static void readTscPair(uint64_t& tsc, uint64_t& ns)
+    {
+        uint64_t bestGap = UINT64_MAX;
+        for (int iter = 0; iter < TSC_CALIBRATION_READS; iter++) {
+            uint64_t before = __rdtsc();
+            uint64_t now = readClockNs(CLOCK_MONOTONIC_RAW);
+            uint64_t after = __rdtsc();
+            if (after - before < bestGap) {
+                bestGap = after - before;
+                tsc = before + (after - before) / 2;
+                ns = now;
+            }
+        }
+    }
+
+    static uint64_t calibrateTsc()
+    {
+        uint64_t tsc0 = 0, ns0 = 0, tsc1 = 0, ns1 = 0;
+        readTscPair(tsc0, ns0);
+        struct timespec pause = {0, long(TSC_CALIBRATION_NS)};
+        nanosleep(&pause, nullptr);
+        readTscPair(tsc1, ns1);
+        if (ns1 <= ns0 || tsc1 <= tsc0) {
+            return 0;
+        }
+        /* rounded to the kHz, the calibration is not finer than that */
+        double freq = double(tsc1 - tsc0) * double(NSEC_PER_SEC) / double(ns1 - ns0);
+        return (uint64_t(freq + 500.0) / 1000) * 1000;
+    }
+
+    /* calibrated once per process, every clock source shares the result */
+    static uint64_t getTscFreq()
+    {
+        static const uint64_t freq = calibrateTsc();
+        return freq;
+    }
+#endif
+
+    static qshClockSourceType fromEnv()
+    {
+        const char* name = getenv("QSH_CLOCK_SOURCE");
+        if (nullptr == name) {
+            return qshClockSourceType::AUTO;
+        }
+        for (qshClockSourceType type : {qshClockSourceType::ARM_GENERIC_TIMER,
+                                        qshClockSourceType::X86_TSC,
+                                        qshClockSourceType::CLOCK_GETTIME}) {
+            if (0 == strcmp(name, toString(type))) {
+                return type;
+            }
+        }
+        sns_loge("unknown QSH_CLOCK_SOURCE %s", name);
+        return qshClockSourceType::AUTO;
+    }
+
+    static qshClockSourceType bestAvailable()
+    {
+#if defined(TARGET_ARM64) || defined(TARGET_ARM)
+        return qshClockSourceType::ARM_GENERIC_TIMER;
+#elif defined(TARGET_X86)
+        if (hasInvariantTsc()) {
+            return qshClockSourceType::X86_TSC;
+        }
+        return qshClockSourceType::CLOCK_GETTIME;
+#else
+        return qshClockSourceType::CLOCK_GETTIME;
+#endif
+    }
+
+    bool init(qshClockSourceType type)
+    {
+        uint64_t freq = 0;
+        switch (type) {
+#if defined(TARGET_ARM64) || defined(TARGET_ARM)
+        case qshClockSourceType::ARM_GENERIC_TIMER:
+            freq = readArmFreq();
+            break;
+#endif
+#if defined(TARGET_X86)
+        case qshClockSourceType::X86_TSC:
+            if (!hasInvariantTsc()) {
+                sns_loge("TSC is not invariant");
+                return false;
+            }
+            freq = getTscFreq();
+            break;
+#endif
+        case qshClockSourceType::CLOCK_GETTIME:
+            freq = NSEC_PER_SEC;
+            break;
+        default:
+            return false;
+        }
+        if (0 == freq) {
+            return false;
+        }
+        mType = type;
+        mFreq = freq;
+        return true;
+    }
+
+    qshClockSourceType mType = qshClockSourceType::CLOCK_GETTIME;
+    uint64_t mFreq = NSEC_PER_SEC;
+};
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include "qshTimeUtil.h"
+#include "qshWorker.h"
+
+/**
+ * @brief quality of the qtimer to android time synchronization
+ */
+struct qshClockSyncStats
+{
+    uint64_t syncs = 0;            /* successful syncs */
+    uint64_t failures = 0;         /* syncs with no valid reading */
+    uint64_t steps = 0;            /* syncs which stepped the mapping */
+    int64_t offsetNs = 0;          /* android - qtimer time at the last sync */
+    double driftPpm = 0.0;         /* drift of android time against qtimer */
+    uint64_t lastGapNs = 0;        /* read gap of the last sync */
+    uint64_t minGapNs = 0;         /* smallest read gap over the window */
+    double jitterNs = 0.0;         /* rms residual of the readings around the fit */
+    double uncertaintyNs = 0.0;    /* estimated error of converted timestamps */
+    int64_t lastSyncRealtimeNs = 0;/* android time of the last sync */
+    size_t windowSize = 0;         /* readings in the window */
+};
+
+/**
+ * @brief called on the sync thread after each successful sync
+ */
+using clockSyncCallBack = std::function<void(const qshClockSyncStats& stats)>;
+
+/**
+ * @brief Background synchronization of qshTimeUtil
+ *
+ * Periodically samples the qtimer and android clocks on its own
+ * worker thread and feeds the readings to qshTimeUtil, which fits
+ * offset and drift over them. While running, qshTimeUtil conversions
+ * no longer sample the clocks themselves: they are pure reads of the
+ * mapping, and the sampling loop stays off the event path.
+ *
+ * The last HISTORY readings are kept to report the sync quality
+ * (read gap, residual jitter, uncertainty).
+ */
+class qshClockSync
+{
+public:
+    static constexpr size_t HISTORY = 16;
+    static constexpr std::chrono::nanoseconds DEFAULT_PERIOD = std::chrono::seconds(10);
+
+    /**
+     * @param period time between two syncs
+     * @param timeUtil time utilities to keep synchronized
+     */
+    explicit qshClockSync(std::chrono::nanoseconds period = DEFAULT_PERIOD,
+                          qshTimeUtil& timeUtil = qshTimeUtil::getInstance());
+    ~qshClockSync();
+
+    qshClockSync(const qshClockSync&) = delete;
+    qshClockSync& operator=(const qshClockSync&) = delete;
+
+    /**
+     * @brief sync right away, then every period
+     *
+     * @return true if started, false if already running or if the
+     *         periodic task could not be scheduled
+     */
+    bool start();
+
+    /**
+     * @brief stop syncing, conversions go back to updating the
+     *        mapping themselves
+     */
+    void stop();
+
+    bool isRunning();
+
+    /**
+     * @brief change the time between two syncs, applied right away
+     *        if running
+     *
+     * @return false if period is not positive
+     */
+    bool setPeriod(std::chrono::nanoseconds period);
+
+    /**
+     * @brief request a sync outside of the schedule, e.g. after
+     *        resume from suspend
+     */
+    void syncNow();
+
+    /**
+     * @brief set a callback to run after each successful sync, e.g. to
+     *        propagate the new offset (see qshDirectChannelTsSync)
+     */
+    void setSyncCallBack(clockSyncCallBack cb);
+
+    /**
+     * @brief apply scheduling attributes to the sync thread
+     *
+     * @return QSH_THREAD_ATTR_OK, or the QSH_THREAD_ATTR_* failure bits
+     */
+    int setThreadAttr(const qshThreadAttr& attr);
+
+    /**
+     * @brief get a snapshot of the sync quality
+     */
+    qshClockSyncStats getStats();
+
+    /**
+     * @brief write the sync quality to the log
+     */
+    void logStats();
+
+private:
+    /* runs on mWorker */
+    void sync();
+
+    qshTimeUtil& mTimeUtil;
+    qshWorker mWorker;
+    std::mutex mMutex;
+    std::chrono::nanoseconds mPeriod;
+    qshTimerId mTimer = QSH_INVALID_TIMER;
+    bool mRunning = false;
+    clockSyncCallBack mSyncCallBack;
+
+    qshClockSyncStats mStats;
+    /* read gaps of the last HISTORY syncs */
+    uint64_t mGaps[HISTORY] = {};
+    size_t mGapsFirst = 0;
+    size_t mGapsCount = 0;
+};
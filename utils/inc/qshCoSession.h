@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include "qshCoTask.h"
+
+#ifdef QSH_HAS_COROUTINES
+#include <map>
+#include <deque>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include "ISession.h"
+#include "SessionFactory.h"
+#include "suidCatalog.h"
+
+using com::quic::sensinghub::session::V1_0::ISession;
+using com::quic::sensinghub::session::V1_0::sessionFactory;
+
+/**
+ * @brief result of an awaited qshCoSession::sendRequest()
+ */
+struct qshCoResponse
+{
+    /* false if the request could not be sent, or the session failed
+       before the response was received */
+    bool received = false;
+    uint32_t respValue = 0;
+    uint64_t clientConnectID = 0;
+};
+
+/**
+ * @brief result of an awaited qshCoSession::nextEvent()
+ */
+struct qshCoEvent
+{
+    /* false if the session failed or was closed */
+    bool valid = false;
+    std::vector<uint8_t> data;
+    uint64_t timestamp = 0;
+};
+
+/**
+ * Coroutine front-end of an ISession.
+ *
+ * Replaces the callback, condition variable and sleep() chains of
+ * ISession clients with awaitables, e.g.
+ *
+ *     qshCoTask<> readAccel(qshCoSession& session)
+ *     {
+ *         auto suids = co_await session.lookUp("accel");
+ *         if (suids.empty() || 0 != co_await session.open()) co_return;
+ *         auto resp = co_await session.sendRequest(suids[0], request);
+ *         while (true) {
+ *             qshCoEvent event = co_await session.nextEvent(suids[0]);
+ *             if (!event.valid) break;
+ *             ...
+ *         }
+ *     }
+ *
+ * No thread is blocked while waiting: awaiting coroutines are resumed
+ * on the executor they were spawned on when the response, event or
+ * lookup result is available.
+ *
+ * Responses of one suid are matched with its requests in order.
+ * Events received while nobody awaits nextEvent() are buffered, up to
+ * MAX_BUFFERED_EVENTS per suid (oldest dropped first).
+ *
+ * @note the qshCoSession must outlive the coroutines awaiting it.
+ *       Destroying it resumes them with a failed result.
+ */
+class qshCoSession
+{
+public:
+    static constexpr size_t MAX_BUFFERED_EVENTS = 64;
+    static constexpr auto DEFAULT_LOOKUP_TIMEOUT = std::chrono::milliseconds(1000);
+
+    /**
+     * @brief creates the session, open() must be awaited before
+     *        sending requests
+     *
+     * @param hubId sensor hub ID. Use -1 for default hub
+     */
+    explicit qshCoSession(int hubId = -1);
+    ~qshCoSession();
+
+    /**
+     * @brief closes the session. Pending awaits are resumed with a
+     *        failed result.
+     */
+    void close();
+
+    /**
+     * @brief number of events dropped because the buffer of their
+     *        suid was full
+     */
+    uint64_t getDroppedEvents();
+
+private:
+    /* time after which a pending lookup re-checks the catalog, just
+       past the catalog's own absent grace period */
+    static constexpr auto LOOKUP_RECHECK_DELAY = std::chrono::milliseconds(250);
+
+    /* a suspended sendRequest() or nextEvent() */
+    struct waiter {
+        qshCoExecutor* executor = nullptr;
+        std::coroutine_handle<> handle;
+        qshCoResponse response;
+        qshCoEvent event;
+    };
+
+    struct channel {
+        std::mutex mutex;
+        std::deque<waiter*> responseWaiters;
+        std::deque<waiter*> eventWaiters;
+        std::deque<qshCoEvent> events;
+        uint64_t droppedEvents = 0;
+    };
+
+    struct lookUpState {
+        std::shared_ptr<suidCatalog> catalog;
+        std::string datatype;
+        std::chrono::milliseconds timeout;
+        std::chrono::steady_clock::time_point deadline;
+        qshCoExecutor* executor = nullptr;
+        std::coroutine_handle<> handle;
+        std::mutex mutex;
+        bool done = false;
+        bool subscribed = false;
+        int subscription = 0;
+        std::vector<suid> suids;
+
+        bool tryComplete();
+    };
+
+public:
+    /* awaitables returned by the methods below */
+    struct openAwaiter {
+        qshCoSession& session;
+        qshCoExecutor* executor = nullptr;
+        std::coroutine_handle<> handle;
+        int result = -1;
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        void await_suspend(std::coroutine_handle<P> h)
+        {
+            executor = h.promise().executor;
+            handle = h;
+            session.startOpen(this);
+        }
+        int await_resume() const noexcept { return result; }
+    };
+
+    struct requestAwaiter : waiter {
+        qshCoSession& session;
+        suid sensorUid;
+        std::string message;
+        requestAwaiter(qshCoSession& s, const suid& uid, std::string&& msg)
+            : session(s), sensorUid(uid), message(std::move(msg)) {}
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        bool await_suspend(std::coroutine_handle<P> h)
+        {
+            executor = h.promise().executor;
+            handle = h;
+            return session.startRequest(sensorUid, message, this);
+        }
+        qshCoResponse await_resume() const noexcept { return response; }
+    };
+
+    struct eventAwaiter : waiter {
+        qshCoSession& session;
+        suid sensorUid;
+        eventAwaiter(qshCoSession& s, const suid& uid) : session(s), sensorUid(uid) {}
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        bool await_suspend(std::coroutine_handle<P> h)
+        {
+            executor = h.promise().executor;
+            handle = h;
+            return session.startNextEvent(sensorUid, this);
+        }
+        qshCoEvent await_resume() noexcept { return std::move(event); }
+    };
+
+    struct lookUpAwaiter {
+        std::shared_ptr<lookUpState> state;
+        bool await_ready() { return state->tryComplete(); }
+        template<typename P>
+        void await_suspend(std::coroutine_handle<P> h)
+        {
+            state->executor = h.promise().executor;
+            state->handle = h;
+            startLookUp(state);
+        }
+        std::vector<suid> await_resume() { return std::move(state->suids); }
+    };
+
+    /**
+     * @brief awaitable opening the session
+     *
+     * ISession::open() blocks, it runs on a helper thread of this
+     * session instead of the executor.
+     *
+     * co_await result: 0 on success, -1 on failure
+     */
+    openAwaiter open() { return openAwaiter{*this}; }
+
+    /**
+     * @brief awaitable sending a request, resolved by its response
+     *
+     * The callbacks of the suid are registered by the first request
+     * (or nextEvent()) for it, events of the request are buffered
+     * from then on.
+     *
+     * co_await result: qshCoResponse
+     */
+    requestAwaiter sendRequest(const suid& sensorUid, std::string message)
+    {
+        return requestAwaiter(*this, sensorUid, std::move(message));
+    }
+
+    /**
+     * @brief awaitable returning the next event of a suid
+     *
+     * co_await result: qshCoEvent, not valid if the session failed
+     */
+    eventAwaiter nextEvent(const suid& sensorUid) { return eventAwaiter(*this, sensorUid); }
+
+    /**
+     * @brief awaitable looking up the suids of a datatype
+     *
+     * Served by the process-wide suidCatalog of this session's hub:
+     * known and absent datatypes resolve without suspending.
+     *
+     * co_await result: std::vector<suid>, empty if the datatype is
+     * absent or the lookup timed out
+     */
+    lookUpAwaiter lookUp(const std::string& datatype,
+        std::chrono::milliseconds timeoutMs = DEFAULT_LOOKUP_TIMEOUT)
+    {
+        auto state = std::make_shared<lookUpState>();
+        state->catalog = suidCatalog::getShared(mHubId);
+        state->datatype = datatype;
+        state->timeout = timeoutMs;
+        return lookUpAwaiter{state};
+    }
+
+private:
+    int openSession();
+    void startOpen(openAwaiter* w);
+    std::shared_ptr<channel> getChannel(const suid& sensorUid);
+    bool startRequest(const suid& sensorUid, const std::string& message, waiter* w);
+    bool startNextEvent(const suid& sensorUid, waiter* w);
+    void onResponse(channel& ch, uint32_t respValue, uint64_t clientConnectID);
+    void onEvent(channel& ch, const uint8_t* data, size_t size, uint64_t timestamp);
+    void onError(channel& ch, ISession::error error);
+    void failWaiters(channel& ch);
+    static void startLookUp(const std::shared_ptr<lookUpState>& state);
+    static void checkLookUp(const std::shared_ptr<lookUpState>& state);
+    static void finishLookUp(const std::shared_ptr<lookUpState>& state);
+
+    const int mHubId;
+    std::unique_ptr<sessionFactory> mSessionFactory;
+    std::unique_ptr<ISession> mSession;
+    bool mOpen = false;
+    std::mutex mMutex;
+    std::map<suid, std::shared_ptr<channel>> mChannels;
+    /* open() awaits queued on mBlockingWorker, failed on destruction
+       if their task did not run */
+    std::vector<openAwaiter*> mPendingOpens;
+    /* runs the blocking ISession calls */
+    qshWorker mBlockingWorker;
+};
+
+#endif /* QSH_HAS_COROUTINES */
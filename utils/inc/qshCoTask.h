@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+/**
+ * C++20 coroutine support. Everything below is only available when
+ * the compiler implements coroutines (e.g. -std=c++20). qshCoSession
+ * is built in the libqshUtil_coroutines library, by configure
+ * --enable-coroutines and by the module of the same name in Android
+ * builds.
+ */
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define QSH_HAS_COROUTINES 1
+
+#include <coroutine>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "qshLog.h"
+#include "qshWorker.h"
+
+/**
+ * Coroutine executor backed by a qshWorker.
+ *
+ * Coroutines scheduled on an executor always resume on its worker
+ * thread, one at a time, so their state needs no locking as long as
+ * it is only touched from that executor. Thousands of coroutines can
+ * share one executor; use a few executors to spread them over cores.
+ *
+ * @note the worker must outlive every coroutine scheduled on it, a
+ *       resumption posted to a worker which is shutting down is lost
+ *       and the coroutine frame leaks.
+ */
+class qshCoExecutor
+{
+public:
+    explicit qshCoExecutor(qshWorker& worker) : mWorker(worker) {}
+
+    /**
+     * @brief resume a suspended coroutine on the worker thread
+     */
+    void post(std::coroutine_handle<> handle)
+    {
+        mWorker.addTask([handle]() { handle.resume(); });
+    }
+
+    /**
+     * @brief run a task on the worker thread after a delay
+     */
+    template<typename F>
+    qshTimerId postDelayed(std::chrono::nanoseconds delay, F&& task)
+    {
+        return mWorker.addDelayedTask(delay, std::forward<F>(task));
+    }
+
+    qshWorker& getWorker() { return mWorker; }
+
+    /**
+     * @brief awaitable suspending the coroutine for a given time,
+     *        without blocking the worker thread
+     */
+    auto sleepFor(std::chrono::nanoseconds delay)
+    {
+        struct awaiter {
+            qshCoExecutor& executor;
+            std::chrono::nanoseconds delay;
+            bool await_ready() const noexcept { return delay.count() <= 0; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                executor.postDelayed(delay, [handle]() { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this, delay};
+    }
+
+private:
+    qshWorker& mWorker;
+};
+
+/**
+ * @brief state common to the promises of every qshCoTask
+ */
+struct qshCoPromiseBase
+{
+    /* executor the coroutine runs on, inherited from its awaiter */
+    qshCoExecutor* executor = nullptr;
+    /* coroutine to resume once this one completes */
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    /* started by qshCoSpawn(), the frame frees itself on completion */
+    bool detached = false;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct finalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+        {
+            qshCoPromiseBase& promise = handle.promise();
+            if (promise.detached) {
+                if (promise.exception) {
+                    try {
+                        std::rethrow_exception(promise.exception);
+                    } catch (const std::exception& e) {
+                        sns_loge("detached coroutine failed, %s", e.what());
+                    } catch (...) {
+                        sns_loge("detached coroutine failed");
+                    }
+                }
+                handle.destroy();
+                return std::noop_coroutine();
+            }
+            if (promise.continuation) {
+                return promise.continuation;
+            }
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+    finalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+/**
+ * Lazily started coroutine returning a T.
+ *
+ * A qshCoTask starts when it is awaited, and runs on the executor of
+ * the coroutine awaiting it. The top-level task of a workflow is
+ * started with qshCoSpawn(). Exceptions thrown by the task are
+ * rethrown to the awaiting coroutine.
+ *
+ * Awaitables of this library (qshCoSession, qshCoExecutor) must be
+ * awaited from a qshCoTask, they resume it on its executor.
+ */
+template<typename T = void>
+class qshCoTask;
+
+template<typename T>
+struct qshCoPromise : qshCoPromiseBase
+{
+    std::optional<T> value;
+
+    qshCoTask<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+    T takeResult()
+    {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template<>
+struct qshCoPromise<void> : qshCoPromiseBase
+{
+    qshCoTask<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void takeResult()
+    {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+template<typename T>
+class qshCoTask
+{
+public:
+    using promise_type = qshCoPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    qshCoTask() = default;
+    explicit qshCoTask(handle_type handle) : mHandle(handle) {}
+    qshCoTask(qshCoTask&& other) noexcept : mHandle(std::exchange(other.mHandle, nullptr)) {}
+    qshCoTask& operator=(qshCoTask&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            mHandle = std::exchange(other.mHandle, nullptr);
+        }
+        return *this;
+    }
+    qshCoTask(const qshCoTask&) = delete;
+    qshCoTask& operator=(const qshCoTask&) = delete;
+    ~qshCoTask() { reset(); }
+
+    bool valid() const { return static_cast<bool>(mHandle); }
+
+    /**
+     * @brief give up ownership of the coroutine frame
+     */
+    handle_type release() { return std::exchange(mHandle, nullptr); }
+
+    struct awaiter {
+        handle_type handle;
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+        /* the child runs inline on the parent's executor */
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> parent) noexcept
+        {
+            handle.promise().executor = parent.promise().executor;
+            handle.promise().continuation = parent;
+            return handle;
+        }
+        T await_resume() { return handle.promise().takeResult(); }
+    };
+
+    awaiter operator co_await() && noexcept { return awaiter{mHandle}; }
+
+private:
+    void reset()
+    {
+        if (mHandle) {
+            mHandle.destroy();
+            mHandle = nullptr;
+        }
+    }
+
+    handle_type mHandle;
+};
+
+template<typename T>
+inline qshCoTask<T> qshCoPromise<T>::get_return_object() noexcept
+{
+    return qshCoTask<T>(std::coroutine_handle<qshCoPromise<T>>::from_promise(*this));
+}
+
+inline qshCoTask<void> qshCoPromise<void>::get_return_object() noexcept
+{
+    return qshCoTask<void>(std::coroutine_handle<qshCoPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief start a workflow on an executor, without waiting for it
+ *
+ * The task is first resumed from the executor's worker thread. Its
+ * coroutine frame is freed when it completes, and an exception
+ * escaping it is logged.
+ */
+inline void qshCoSpawn(qshCoExecutor& executor, qshCoTask<void>&& task)
+{
+    auto handle = task.release();
+    if (!handle) {
+        return;
+    }
+    handle.promise().executor = &executor;
+    handle.promise().detached = true;
+    executor.post(handle);
+}
+
+#endif /* __cpp_impl_coroutine */
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include "qshTickConverter.h"
+#include "qshTimeUtil.h"
+
+/**
+ * @brief sends an encoded sns_direct_channel_config_msg to a direct
+ *        channel, returns 0 on success
+ */
+using directChannelConfigSender = std::function<int(const uint8_t* msg, size_t msgLen)>;
+
+/**
+ * @brief Programs the timestamp offset of direct channels
+ *
+ * The hub adds the sns_direct_channel_set_ts_offset of a channel to
+ * the timestamps of all samples delivered on it, so clients get them
+ * in android time with no conversion per sample. This class computes
+ * that offset (in ticks) from the qshTimeUtil mapping, pushes it to
+ * each channel registered, and pushes it again when the estimate has
+ * moved by more than a threshold since the last push (drift, or a
+ * step of the mapping).
+ *
+ * update() is meant to run after each clock sync, e.g. from the
+ * qshClockSync sync callback.
+ */
+class qshDirectChannelTsSync
+{
+public:
+    static constexpr int64_t DEFAULT_THRESHOLD_NS = 50000;
+    /* largest encoded sns_direct_channel_config_msg with a set_ts_offset */
+    static constexpr size_t MAX_CONFIG_MSG_LEN = 16;
+
+    /**
+     * @param thresholdNs change of the offset which triggers a new push
+     * @param timeUtil time utilities providing the mapping
+     */
+    explicit qshDirectChannelTsSync(int64_t thresholdNs = DEFAULT_THRESHOLD_NS,
+                                    qshTimeUtil& timeUtil = qshTimeUtil::getInstance());
+
+    /**
+     * @brief register a direct channel and push the current offset
+     *        to it
+     *
+     * @param sender sends config messages to the channel. It is called
+     *        with the internal lock held and must not call back into
+     *        this object.
+     *
+     * @return handle of the channel, -1 if sender is empty. The
+     *         channel is registered even if the first push fails, it
+     *         is retried on the next update().
+     */
+    int addChannel(directChannelConfigSender sender);
+
+    /**
+     * @brief stop updating the offset of a channel
+     */
+    void removeChannel(int handle);
+
+    /**
+     * @brief push the current offset to the channels whose offset
+     *        moved past the threshold, or failed to be pushed
+     *
+     * @param force push to all channels
+     *
+     * @return number of channels the offset was pushed to
+     */
+    size_t update(bool force = false);
+
+    /**
+     * @brief get the offset last pushed to a channel, in ticks
+     *
+     * @return false if the channel is unknown or nothing was pushed yet
+     */
+    bool getChannelOffset(int handle, int64_t& offsetTicks);
+
+    /**
+     * @brief current android - qtimer offset, in ns and in ticks
+     */
+    void getOffset(int64_t& offsetNs, int64_t& offsetTicks);
+
+    /**
+     * @brief encode a sns_direct_channel_config_msg setting the
+     *        timestamp offset
+     *
+     * @param offsetTicks offset to set, negative values wrap as in the
+     *        hub's 64-bit tick arithmetic
+     * @param buf output buffer, at least MAX_CONFIG_MSG_LEN bytes
+     * @param bufLen size of buf
+     * @param msgLen length of the encoded message
+     *
+     * @return true on success
+     */
+    static bool encodeTsOffset(int64_t offsetTicks, uint8_t* buf, size_t bufLen, size_t& msgLen);
+
+private:
+    struct channel {
+        directChannelConfigSender sender;
+        bool pushed = false;
+        int64_t offsetNs = 0;
+        int64_t offsetTicks = 0;
+    };
+
+    int64_t nsToTicks(int64_t ns) const;
+    bool push(int handle, channel& ch, int64_t offsetNs, int64_t offsetTicks);
+
+    qshTimeUtil& mTimeUtil;
+    const int64_t mThresholdNs;
+    const qshTickConverter mNsToTicks;
+    std::mutex mMutex;
+    std::map<int, channel> mChannels;
+    int mNextHandle = 1;
+};
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature, size_t Capacity>
+class qshInplaceFunction;
+
+/**
+ * Move-only callable wrapper which never allocates.
+ *
+ * The callable is stored in an inline buffer of Capacity bytes. A
+ * callable which does not fit, is over-aligned or cannot be moved
+ * without throwing is rejected at compile time, so constructing,
+ * moving and invoking a qshInplaceFunction never touches the heap.
+ *
+ * Unlike std::function, the wrapped callable does not need to be
+ * copyable (e.g. lambdas capturing a std::unique_ptr are accepted).
+ */
+template<typename R, typename... Args, size_t Capacity>
+class qshInplaceFunction<R(Args...), Capacity>
+{
+public:
+    qshInplaceFunction() noexcept = default;
+    qshInplaceFunction(std::nullptr_t) noexcept {}
+
+    template<typename F,
+             typename Fn = typename std::decay<F>::type,
+             typename = typename std::enable_if<
+                 !std::is_same<Fn, qshInplaceFunction>::value>::type>
+    qshInplaceFunction(F&& f)
+    {
+        static_assert(sizeof(Fn) <= Capacity,
+            "callable too large for qshInplaceFunction, increase its capacity");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t),
+            "over-aligned callable not supported by qshInplaceFunction");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value,
+            "callable stored in qshInplaceFunction must be nothrow movable");
+        ::new (static_cast<void*>(&mStorage)) Fn(std::forward<F>(f));
+        mOps = &opsFor<Fn>::ops;
+    }
+
+    qshInplaceFunction(qshInplaceFunction&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    qshInplaceFunction& operator=(qshInplaceFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    qshInplaceFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    qshInplaceFunction(const qshInplaceFunction&) = delete;
+    qshInplaceFunction& operator=(const qshInplaceFunction&) = delete;
+
+    ~qshInplaceFunction()
+    {
+        reset();
+    }
+
+    R operator()(Args... args)
+    {
+        return mOps->invoke(&mStorage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return nullptr != mOps; }
+    bool operator==(std::nullptr_t) const noexcept { return nullptr == mOps; }
+    bool operator!=(std::nullptr_t) const noexcept { return nullptr != mOps; }
+    friend bool operator==(std::nullptr_t, const qshInplaceFunction& f) noexcept { return f == nullptr; }
+    friend bool operator!=(std::nullptr_t, const qshInplaceFunction& f) noexcept { return f != nullptr; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    /**
+     * @brief whether a callable of type Fn can be stored inline
+     */
+    template<typename Fn>
+    static constexpr bool fits()
+    {
+        return sizeof(Fn) <= Capacity && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+private:
+    using storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+    struct operations {
+        R (*invoke)(void* obj, Args&&... args);
+        /* move-constructs into dst and destroys src */
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void* obj);
+    };
+
+    template<typename Fn>
+    struct opsFor {
+        static R invoke(void* obj, Args&&... args)
+        {
+            return (*static_cast<Fn*>(obj))(std::forward<Args>(args)...);
+        }
+        static void relocate(void* dst, void* src)
+        {
+            ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void destroy(void* obj)
+        {
+            static_cast<Fn*>(obj)->~Fn();
+        }
+        static constexpr operations ops = {&invoke, &relocate, &destroy};
+    };
+
+    void moveFrom(qshInplaceFunction& other) noexcept
+    {
+        if (nullptr != other.mOps) {
+            other.mOps->relocate(&mStorage, &other.mStorage);
+            mOps = other.mOps;
+            other.mOps = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (nullptr != mOps) {
+            mOps->destroy(&mStorage);
+            mOps = nullptr;
+        }
+    }
+
+    storage mStorage;
+    const operations* mOps = nullptr;
+};
+
+template<typename R, typename... Args, size_t Capacity>
+template<typename Fn>
+constexpr typename qshInplaceFunction<R(Args...), Capacity>::operations
+    qshInplaceFunction<R(Args...), Capacity>::opsFor<Fn>::ops;
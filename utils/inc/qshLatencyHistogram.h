@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Log-linear (HDR style) histogram of durations in ns
+ *
+ * Each power of two is split in SUB_BUCKETS linear buckets, so any
+ * recorded value is known within 1/SUB_BUCKETS (about 3%) over the
+ * whole range, with a fixed-size table and no allocation. Values above
+ * MAX_VALUE_NS are counted in the last bucket, the exact maximum is
+ * kept aside.
+ *
+ * record() is meant for a single recording thread: counters are
+ * relaxed atomics updated without read-modify-write, which keeps the
+ * recording cost to a few ns while snapshots can be taken from any
+ * thread.
+ */
+class qshLatencyHistogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ull << SUB_BUCKET_BITS;
+    /* largest value with its own bucket, ~68 s */
+    static constexpr unsigned MAX_VALUE_BITS = 36;
+    static constexpr uint64_t MAX_VALUE_NS = (1ull << MAX_VALUE_BITS) - 1;
+    static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /**
+     * @brief Copy of the content of a histogram
+     */
+    struct snapshot
+    {
+        uint64_t count = 0;
+        uint64_t minNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t sumNs = 0;
+        uint64_t buckets[BUCKETS] = {};
+
+        double meanNs() const { return (0 != count) ? double(sumNs) / double(count) : 0.0; }
+
+        /**
+         * @brief value below which the given percentile of the
+         *        samples fall, within the bucket precision
+         *
+         * @param percentile 0 to 100
+         */
+        uint64_t percentileNs(double percentile) const
+        {
+            if (0 == count) {
+                return 0;
+            }
+            uint64_t rank = uint64_t(double(count) * percentile / 100.0);
+            if (rank >= count) {
+                return maxNs;
+            }
+            uint64_t seen = 0;
+            for (size_t idx = 0; idx < BUCKETS; idx++) {
+                seen += buckets[idx];
+                if (seen > rank) {
+                    uint64_t value = highestOf(idx);
+                    return (value < maxNs) ? value : maxNs;
+                }
+            }
+            return maxNs;
+        }
+
+        /**
+         * @brief add the samples of another snapshot
+         */
+        void merge(const snapshot& other)
+        {
+            if (0 == other.count) {
+                return;
+            }
+            minNs = (0 == count || other.minNs < minNs) ? other.minNs : minNs;
+            maxNs = (other.maxNs > maxNs) ? other.maxNs : maxNs;
+            count += other.count;
+            sumNs += other.sumNs;
+            for (size_t idx = 0; idx < BUCKETS; idx++) {
+                buckets[idx] += other.buckets[idx];
+            }
+        }
+    };
+
+    qshLatencyHistogram() { reset(); }
+
+    qshLatencyHistogram(const qshLatencyHistogram&) = delete;
+    qshLatencyHistogram& operator=(const qshLatencyHistogram&) = delete;
+
+    /**
+     * @brief add a sample, from the recording thread only
+     */
+    void record(uint64_t valueNs)
+    {
+        size_t idx = indexOf(valueNs);
+        bump(mBuckets[idx], 1);
+        bump(mCount, 1);
+        bump(mSumNs, valueNs);
+        if (valueNs > mMaxNs.load(std::memory_order_relaxed)) {
+            mMaxNs.store(valueNs, std::memory_order_relaxed);
+        }
+        if (valueNs < mMinNs.load(std::memory_order_relaxed)) {
+            mMinNs.store(valueNs, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief copy the histogram, from any thread. Samples recorded
+     *        meanwhile may be partially included.
+     */
+    void getSnapshot(snapshot& snap) const
+    {
+        snap.count = 0;
+        for (size_t idx = 0; idx < BUCKETS; idx++) {
+            snap.buckets[idx] = mBuckets[idx].load(std::memory_order_relaxed);
+            snap.count += snap.buckets[idx];
+        }
+        snap.sumNs = mSumNs.load(std::memory_order_relaxed);
+        snap.maxNs = mMaxNs.load(std::memory_order_relaxed);
+        snap.minNs = (0 != snap.count) ? mMinNs.load(std::memory_order_relaxed) : 0;
+    }
+
+    /**
+     * @brief clear the histogram, from the recording thread or while
+     *        nothing is recorded
+     */
+    void reset()
+    {
+        for (size_t idx = 0; idx < BUCKETS; idx++) {
+            mBuckets[idx].store(0, std::memory_order_relaxed);
+        }
+        mCount.store(0, std::memory_order_relaxed);
+        mSumNs.store(0, std::memory_order_relaxed);
+        mMaxNs.store(0, std::memory_order_relaxed);
+        mMinNs.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+
+    uint64_t getCount() const { return mCount.load(std::memory_order_relaxed); }
+
+    /* bucket of a value */
+    static size_t indexOf(uint64_t valueNs)
+    {
+        if (valueNs > MAX_VALUE_NS) {
+            return BUCKETS - 1;
+        }
+        if (valueNs < 2 * SUB_BUCKETS) {
+            return size_t(valueNs);
+        }
+        unsigned shift = unsigned(63 - __builtin_clzll(valueNs)) - SUB_BUCKET_BITS;
+        return size_t((shift + 1) * SUB_BUCKETS + ((valueNs >> shift) - SUB_BUCKETS));
+    }
+
+    /* largest value of a bucket */
+    static uint64_t highestOf(size_t idx)
+    {
+        if (idx < 2 * SUB_BUCKETS) {
+            return idx;
+        }
+        unsigned shift = unsigned(idx / SUB_BUCKETS) - 1;
+        uint64_t lowest = (uint64_t(idx % SUB_BUCKETS) + SUB_BUCKETS) << shift;
+        return lowest + (1ull << shift) - 1;
+    }
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> mBuckets[BUCKETS];
+    std::atomic<uint64_t> mCount;
+    std::atomic<uint64_t> mSumNs;
+    std::atomic<uint64_t> mMaxNs;
+    std::atomic<uint64_t> mMinNs;
+};
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ISession.h"
+#include "suidMap.h"
+#include "qshLatencyHistogram.h"
+#include "qshTimeUtil.h"
+
+using suid = com::quic::sensinghub::suid;
+
+using com::quic::sensinghub::session::V1_0::ISession;
+
+/**
+ * @brief Latency summary of the events of one sensor
+ */
+struct qshLatencySnapshot
+{
+    suid sensorUid;
+    uint64_t events = 0;        /* events recorded */
+    uint64_t early = 0;         /* events received before their timestamp */
+    uint64_t minNs = 0;
+    uint64_t maxNs = 0;
+    double meanNs = 0.0;
+    uint64_t p50Ns = 0;
+    uint64_t p99Ns = 0;
+    uint64_t p999Ns = 0;
+    /* inter-arrival jitter, smoothed as in RFC 3550 */
+    uint64_t jitterNs = 0;
+    /* 99th percentile of the latency change between two events */
+    uint64_t jitterP99Ns = 0;
+};
+
+/**
+ * @brief Per-sensor latency of the events delivered to the client
+ *
+ * The latency of an event is the time from its hub timestamp
+ * (sns_client_event.timestamp, in QTimer ticks) to its reception,
+ * both converted to ns through qshTimeUtil. It covers sampling to
+ * delivery: batching, transport and dispatch.
+ *
+ * Each sensor gets a handle, and recording through a handle costs a
+ * clock read, a conversion and two histogram updates, with no lock
+ * and no allocation. Events of a sensor must be recorded by one thread
+ * at a time, which is how sessions deliver them; snapshots can be
+ * taken from any thread.
+ */
+class qshLatencyMonitor
+{
+public:
+    static constexpr size_t MAX_SENSORS = 64;
+
+    explicit qshLatencyMonitor(qshTimeUtil& timeUtil = qshTimeUtil::getInstance());
+    ~qshLatencyMonitor();
+
+    qshLatencyMonitor(const qshLatencyMonitor&) = delete;
+    qshLatencyMonitor& operator=(const qshLatencyMonitor&) = delete;
+
+    /**
+     * @brief get the handle recording the events of a sensor,
+     *        registering it on first use
+     *
+     * @return handle, -1 if MAX_SENSORS sensors are registered already
+     */
+    int getHandle(const suid& sensorUid);
+
+    /**
+     * @brief get the handle of a sensor, without registering it
+     *
+     * @return handle, -1 if the sensor is not registered
+     */
+    int findHandle(const suid& sensorUid);
+
+    /**
+     * @brief record an event received now
+     *
+     * @param handle from getHandle()
+     * @param eventTicks hub timestamp of the event, in ticks
+     */
+    void record(int handle, uint64_t eventTicks)
+    {
+        record(handle, eventTicks, mTimeUtil.qtimerGetTicks());
+    }
+
+    /**
+     * @brief record an event received at a given time, e.g. the events
+     *        of a batch with a single clock read
+     *
+     * @param handle from getHandle()
+     * @param eventTicks hub timestamp of the event, in ticks
+     * @param receiveTicks reception time, in ticks
+     */
+    void record(int handle, uint64_t eventTicks, uint64_t receiveTicks)
+    {
+        if (handle < 0 || size_t(handle) >= MAX_SENSORS) {
+            return;
+        }
+        sensorEntry* entry = mEntries[handle].load(std::memory_order_acquire);
+        if (nullptr == entry) {
+            return;
+        }
+        uint64_t eventNs = mTimeUtil.qtimerTicksToNs(eventTicks);
+        uint64_t receiveNs = mTimeUtil.qtimerTicksToNs(receiveTicks);
+        int64_t latencyNs = int64_t(receiveNs - eventNs);
+        if (latencyNs < 0) {
+            entry->early.store(entry->early.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+            latencyNs = 0;
+        }
+        entry->latency.record(uint64_t(latencyNs));
+        if (entry->hasLast) {
+            /* RFC 3550: J += (|D| - J) / 16, kept as 16 * J */
+            int64_t diff = latencyNs - entry->lastLatencyNs;
+            uint64_t absDiff = uint64_t(diff < 0 ? -diff : diff);
+            entry->jitter.record(absDiff);
+            int64_t jitter16 = entry->jitter16.load(std::memory_order_relaxed);
+            jitter16 += int64_t(absDiff) - ((jitter16 + 8) >> 4);
+            entry->jitter16.store(jitter16, std::memory_order_relaxed);
+        }
+        entry->lastLatencyNs = latencyNs;
+        entry->hasLast = true;
+    }
+
+    /**
+     * @brief wrap an event callback to record the latency of each
+     *        event before handing it over
+     *
+     * The timestamp passed to the callback is the hub timestamp of
+     * the event, in ticks.
+     */
+    ISession::eventCallBack wrapEventCallBack(const suid& sensorUid, ISession::eventCallBack cb);
+
+    /**
+     * @brief get the latency summary of a sensor
+     *
+     * @return false if the handle is not registered
+     */
+    bool getSnapshot(int handle, qshLatencySnapshot& snap);
+
+    /**
+     * @brief get the latency summary of all registered sensors
+     */
+    std::vector<qshLatencySnapshot> getSnapshots();
+
+    /**
+     * @brief copy the full latency and jitter histograms of a sensor
+     *
+     * @return false if the handle is not registered
+     */
+    bool getHistograms(int handle, qshLatencyHistogram::snapshot& latency,
+                       qshLatencyHistogram::snapshot& jitter);
+
+    /**
+     * @brief clear the recorded events of all sensors. Events recorded
+     *        meanwhile may be partially kept.
+     */
+    void reset();
+
+    /**
+     * @brief write the latency summary of all sensors to the log
+     */
+    void logStats();
+
+    /**
+     * @brief export the latency summary of all sensors as CSV, one line
+     *        per sensor after a header line, times in ns
+     */
+    std::string exportCsv();
+
+private:
+    struct sensorEntry {
+        suid sensorUid;
+        qshLatencyHistogram latency;
+        qshLatencyHistogram jitter;
+        std::atomic<uint64_t> early{0};
+        std::atomic<int64_t> jitter16{0};
+        /* recording thread only */
+        int64_t lastLatencyNs = 0;
+        bool hasLast = false;
+    };
+
+    void fillSnapshot(sensorEntry& entry, qshLatencySnapshot& snap);
+
+    qshTimeUtil& mTimeUtil;
+    std::mutex mMutex;
+    com::quic::sensinghub::suidFlatMap<int> mHandles;
+    size_t mNumEntries = 0;
+    std::atomic<sensorEntry*> mEntries[MAX_SENSORS];
+};
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include "qshLog.h"
+#include "qshWorker.h"
+#include "qshMpscQueue.h"
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/**
+ * Worker thread fed by a bounded lock-free task queue.
+ *
+ * Drop-in alternative to qshWorker for producers posting at event
+ * rate. addTask() never takes a lock: the task is pushed to a
+ * qshMpscQueue and the worker is only signalled if it is parked, so a
+ * burst of tasks costs at most one wakeup. When its queue runs dry,
+ * the worker spins briefly before parking on a futex (a condition
+ * variable where futexes are not available).
+ *
+ * Tasks are stored as workerInplaceTask, so queueing a task never
+ * allocates. As with qshWorker, tasks run in the order they are added
+ * and tasks still queued at shutdown are dropped.
+ */
+class qshLockFreeWorker
+{
+public:
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+    /**
+     * @brief creates a worker thread and starts processing tasks
+     *
+     * @param capacity maximum number of pending tasks, rounded up to
+     *        a power of two
+     */
+    explicit qshLockFreeWorker(size_t capacity = DEFAULT_QUEUE_CAPACITY)
+        : mQueue(capacity), mAlive(true)
+    {
+        mThread = std::thread([this] { run(); });
+    }
+
+    /**
+     * @brief terminates the worker thread, after shutting it down
+     *
+     * @note this destructor should never be called from the worker
+     *       thread itself.
+     */
+    ~qshLockFreeWorker()
+    {
+        shutdownWorker();
+    }
+
+    /**
+     * @brief Signals the worker thread to stop processing tasks,
+     *        waits until the thread completes execution.
+     */
+    void shutdownWorker()
+    {
+        if (!mAlive.exchange(false)) {
+            return;
+        }
+        mParked.store(0);
+        wake();
+        mThread.join();
+    }
+
+    void setName(const char *name)
+    {
+#ifndef _WIN32
+        pthread_setname_np(mThread.native_handle(), name);
+#endif
+    }
+
+    /**
+     * @brief apply scheduling attributes to the worker thread
+     *
+     * @return QSH_THREAD_ATTR_OK, or the QSH_THREAD_ATTR_* bits of
+     *         the attributes which could not be applied
+     *
+     * @see qshWorker::setThreadAttr()
+     */
+    int setThreadAttr(const qshThreadAttr& attr)
+    {
+#ifndef _WIN32
+        return qshApplyThreadAttr(mThread.native_handle(), attr, "lockfree-worker");
+#else
+        return QSH_THREAD_ATTR_UNSUPPORTED;
+#endif
+    }
+
+    /**
+     * @brief add a new task for the worker to do, from any thread
+     *
+     * Tasks are performed in order in which they are added
+     *
+     * @param task task to perform
+     *
+     * @return false if the worker is shutting down or the queue is
+     *         full, true otherwise
+     */
+    bool addTask(const workerTask& task)
+    {
+        if (nullptr == task) {
+            return false;
+        }
+        return addTask(workerInplaceTask(task));
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerInplaceTask>::value &&
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    bool addTask(F&& task)
+    {
+        return addTask(makeWorkerTask(std::forward<F>(task)));
+    }
+
+    bool addTask(workerInplaceTask&& task)
+    {
+        if (!mAlive.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (!mQueue.push(std::move(task))) {
+            sns_loge("failed to add new task, queue full (%zu)", mQueue.capacity());
+            return false;
+        }
+        /* pairs with the fence in park(): either the worker sees the
+           new task, or this thread sees the worker parked */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (0 != mParked.load(std::memory_order_relaxed) && 0 != mParked.exchange(0)) {
+            wake();
+        }
+        return true;
+    }
+
+private:
+    /* empty polls before the worker parks */
+    static constexpr int SPIN_COUNT = 256;
+
+    /* worker thread's mainloop */
+    void run()
+    {
+        workerInplaceTask task;
+        int idle = 0;
+        while (mAlive.load(std::memory_order_relaxed)) {
+            if (mQueue.pop(task)) {
+                idle = 0;
+                try {
+                    if (nullptr != task) {
+                        task();
+                    }
+                } catch (const std::exception& e) {
+                    /* if an unhandled exception happened when running
+                       the task, just log it and move on */
+                    sns_loge("task failed, %s", e.what());
+                }
+                task = nullptr;
+            } else if (++idle < SPIN_COUNT) {
+                std::this_thread::yield();
+            } else {
+                idle = 0;
+                park();
+            }
+        }
+        /* release the tasks which will not run */
+        while (mQueue.pop(task)) {
+            task = nullptr;
+        }
+    }
+
+    void park()
+    {
+        mParked.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!mQueue.empty() || !mAlive.load(std::memory_order_relaxed)) {
+            mParked.store(0, std::memory_order_relaxed);
+            return;
+        }
+#ifdef __linux__
+        while (1 == mParked.load(std::memory_order_acquire)) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mParked),
+                    FUTEX_WAIT_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+#else
+        std::unique_lock<std::mutex> lk(mMutex);
+        while (1 == mParked.load(std::memory_order_acquire)) {
+            mConditionVar.wait(lk);
+        }
+#endif
+    }
+
+    void wake()
+    {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mParked),
+                FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lk(mMutex);
+        mConditionVar.notify_one();
+#endif
+    }
+
+    qshMpscQueue<workerInplaceTask> mQueue;
+    std::atomic<bool> mAlive;
+    /* 1 while the worker is parked or about to park */
+    std::atomic<uint32_t> mParked{0};
+#ifndef __linux__
+    std::mutex mMutex;
+    std::condition_variable mConditionVar;
+#endif
+    std::thread mThread;
+};
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free multi-producer/single-consumer queue.
+ *
+ * The queue is a ring of cells, each tagged with a sequence number
+ * telling whether it is free for the producer claiming that position
+ * or holds a value for the consumer. Producers claim positions with a
+ * single CAS, the consumer never writes to shared state other than the
+ * cell it releases, so neither side ever blocks the other.
+ *
+ * Capacity is rounded up to a power of two. push() fails instead of
+ * blocking when the ring is full. pop() must only be called from one
+ * thread at a time.
+ *
+ * T must be default constructible and move assignable.
+ */
+template<typename T>
+class qshMpscQueue
+{
+public:
+    explicit qshMpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mCells.reset(new cell[size]);
+        for (size_t idx = 0; idx < size; idx++) {
+            mCells[idx].seq.store(idx, std::memory_order_relaxed);
+        }
+        mMask = size - 1;
+    }
+
+    qshMpscQueue(const qshMpscQueue&) = delete;
+    qshMpscQueue& operator=(const qshMpscQueue&) = delete;
+
+    /**
+     * @brief add a value, may be called from any thread
+     *
+     * @return false if the queue is full, in which case value is
+     *         left untouched
+     */
+    bool push(T&& value)
+    {
+        cell* target;
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            target = &mCells[pos & mMask];
+            size_t seq = target->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (0 == dif) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                /* the consumer has not released this cell yet */
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        target->data = std::move(value);
+        target->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& value)
+    {
+        T copy(value);
+        return push(std::move(copy));
+    }
+
+    /**
+     * @brief remove the oldest value, single consumer only
+     *
+     * @return false if the queue is empty
+     */
+    bool pop(T& value)
+    {
+        cell* target = &mCells[mDequeuePos & mMask];
+        size_t seq = target->seq.load(std::memory_order_acquire);
+        if (seq != mDequeuePos + 1) {
+            return false;
+        }
+        value = std::move(target->data);
+        /* drop whatever the moved-from value still holds */
+        target->data = T();
+        target->seq.store(mDequeuePos + mMask + 1, std::memory_order_release);
+        mDequeuePos++;
+        return true;
+    }
+
+    /**
+     * @brief check whether a value is ready for the consumer
+     *
+     * @note only meaningful when called from the consumer thread
+     */
+    bool empty() const
+    {
+        const cell* target = &mCells[mDequeuePos & mMask];
+        return target->seq.load(std::memory_order_acquire) != mDequeuePos + 1;
+    }
+
+    size_t capacity() const { return mMask + 1; }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::unique_ptr<cell[]> mCells;
+    size_t mMask = 0;
+    /* producer and consumer positions on separate cache lines */
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> mEnqueuePos{0};
+    alignas(CACHE_LINE_SIZE) size_t mDequeuePos = 0;
+};
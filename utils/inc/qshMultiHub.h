@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "ISession.h"
+#include "SessionFactory.h"
+#include "suidCatalog.h"
+#include "suidMap.h"
+
+/**
+ * @brief A suid tagged with the hub that owns it
+ */
+struct hubSuid
+{
+    int hubId;
+    suid sensorUid;
+};
+
+/**
+ * @brief Multi-hub discovery coordinator and request router
+ *
+ * qshMultiHub enumerates the available sensing hubs and keeps one
+ * suidCatalog and one data session per hub. Discovery runs on all
+ * hubs concurrently, so on multi-hub targets it takes as long as the
+ * slowest hub instead of the sum of all hubs. Results are merged and
+ * tagged with the owning hub, and setCallBacks()/sendRequest() are
+ * forwarded to the session of the hub owning the suid.
+ *
+ * The suid-to-hub ownership table follows the catalogs, so sensors
+ * that appear after discovery are routed as well.
+ */
+class qshMultiHub
+{
+public:
+    /**
+     * @brief enumerates the available hubs, no session is opened yet
+     */
+    qshMultiHub();
+    ~qshMultiHub();
+
+    /**
+     * @brief get the IDs of the hubs handled by this instance
+     */
+    std::vector<int> getHubIds() const;
+
+    /**
+     * @brief discover the given datatypes on all hubs in parallel
+     *
+     * On first call, this also opens the lookup and data sessions of
+     * every hub, again in parallel. Concurrent calls wait for the
+     * sessions to be open, not for each other's discovery.
+     *
+     * @param datatypes datatypes to look up (e.g., "accel", "gyro")
+     * @param timeoutMs maximum time to wait for each hub
+     *
+     * @return suids found for the datatypes, tagged with their hub
+     */
+    std::vector<hubSuid> discover(const std::vector<std::string>& datatypes,
+        std::chrono::milliseconds timeoutMs = DEFAULT_DISCOVERY_TIMEOUT);
+
+    /**
+     * @brief get the suids known for a datatype on all hubs
+     */
+    std::vector<hubSuid> getSuids(const std::string& datatype);
+
+    /**
+     * @brief get the hub owning a suid
+     *
+     * @return hub ID, or -1 if the suid has not been discovered
+     */
+    int getOwnerHub(const suid& sensorUid);
+
+    /**
+     * @brief set the callbacks of a suid on the session of its hub
+     *
+     * @return 0 on success, -1 if the owning hub is unknown or the
+     *         session rejected the callbacks
+     *
+     * @see ISession::setCallBacks()
+     */
+    int setCallBacks(suid sensorUid, ISession::respCallBack respCB,
+        ISession::errorCallBack errorCB, ISession::eventCallBack eventCB);
+
+    /**
+     * @brief send a request to the hub owning the suid
+     *
+     * @return 0 on success, -1 if the owning hub is unknown or the
+     *         request could not be sent
+     *
+     * @see ISession::sendRequest()
+     */
+    int sendRequest(suid sensorUid, std::string message);
+
+private:
+    static constexpr auto DEFAULT_DISCOVERY_TIMEOUT = std::chrono::milliseconds(1000);
+
+    struct hubContext {
+        int hubId = -1;
+        std::unique_ptr<sessionFactory> factory;
+        std::unique_ptr<ISession> session;
+        std::unique_ptr<suidCatalog> catalog;
+        int subscription = -1;
+    };
+
+    /* hubs listing an suid, with the number of their datatypes listing
+       it; the first hub owns the suid */
+    struct suidOwners {
+        std::vector<std::pair<int, uint32_t>> hubs;
+    };
+
+    void forEachHub(const std::function<void(hubContext&)>& task);
+    void openHub(hubContext& hub);
+    void discoverHub(hubContext& hub, const std::vector<std::string>& datatypes,
+        std::chrono::steady_clock::time_point deadline);
+    void onDelta(int hubId, const suidDelta& delta);
+    ISession* getOwnerSession(const suid& sensorUid);
+
+    std::vector<std::unique_ptr<hubContext>> mHubs;
+    /* set once the sessions and catalogs of all hubs are created, they
+       are not changed again until destruction */
+    std::atomic<bool> mOpened{false};
+    /* serializes the opening of the hubs */
+    std::mutex mOpenMutex;
+    com::quic::sensinghub::suidFlatMap<suidOwners> mOwners;
+    std::mutex mMutex;
+};
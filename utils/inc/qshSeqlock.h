@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/**
+ * @brief Sequence lock publishing a small value to many readers
+ *
+ * Readers never block nor write shared memory: they copy the value
+ * and retry only if a store overlapped the copy. Stores must be
+ * serialized by the caller (single writer).
+ *
+ * The value is kept in relaxed atomic words, so concurrent copies are
+ * not data races; T must be trivially copyable.
+ */
+template<typename T>
+class qshSeqlock
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock value must be trivially copyable");
+
+    qshSeqlock() : qshSeqlock(T()) {}
+
+    explicit qshSeqlock(const T& value)
+    {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+        for (size_t idx = 0; idx < WORDS; idx++) {
+            mWords[idx].store(words[idx], std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief publish a new value, callers must be serialized
+     */
+    void store(const T& value)
+    {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+        uint32_t seq = mSeq.load(std::memory_order_relaxed);
+        mSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t idx = 0; idx < WORDS; idx++) {
+            mWords[idx].store(words[idx], std::memory_order_relaxed);
+        }
+        mSeq.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief read a consistent copy of the value
+     */
+    T load() const
+    {
+        uint64_t words[WORDS];
+        uint32_t before, after;
+        do {
+            before = mSeq.load(std::memory_order_acquire);
+            for (size_t idx = 0; idx < WORDS; idx++) {
+                words[idx] = mWords[idx].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = mSeq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    /* odd while a store is in progress */
+    std::atomic<uint32_t> mSeq{0};
+    std::atomic<uint64_t> mWords[WORDS];
+};
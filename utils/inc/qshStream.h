@@ -0,0 +1,572 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+/**
+ * Stream operators over decoded sensor events.
+ *
+ * A pipeline is described with qshStream() and operators chained with
+ * '|', and instantiated with to(sink):
+ *
+ *     auto pipeline = (qshStream()
+ *         | qshFilter([](const accelSample& s) { return s.valid; })
+ *         | qshDecimate(4)
+ *         | qshMap([](const accelSample& s) { return magnitude(s); }))
+ *         .to([](float m) { ... });
+ *
+ *     eventCallBack = [&](...) { pipeline(decode(...)); };
+ *
+ * to() nests the stages into a single object, each stage holding the
+ * next one by value, so calling the pipeline compiles to one inlined
+ * call chain: no virtual call, queue or heap allocation per stage.
+ * Stateful stages (window, merge) use fixed-size storage.
+ *
+ * Pipelines are not thread-safe, feed a pipeline from one thread (or
+ * one qshWorker) at a time.
+ */
+
+/**
+ * @brief default timestamp accessor of events, reads their
+ *        timestamp member (in ns)
+ */
+struct qshEventTimestamp
+{
+    template<typename T>
+    uint64_t operator()(const T& event) const { return event.timestamp; }
+};
+
+/**
+ * @brief fixed-capacity FIFO ring used by the stateful stages
+ */
+template<typename T, size_t N>
+class qshStreamRing
+{
+public:
+    static_assert(N > 0, "ring capacity must not be zero");
+
+    bool empty() const { return 0 == mCount; }
+    bool full() const { return N == mCount; }
+    size_t size() const { return mCount; }
+
+    /* oldest first */
+    const T& operator[](size_t idx) const { return mItems[(mHead + idx) % N]; }
+    const T& front() const { return mItems[mHead]; }
+
+    /* drops the oldest item when full */
+    void push(const T& item)
+    {
+        if (full()) {
+            pop();
+        }
+        mItems[(mHead + mCount) % N] = item;
+        mCount++;
+    }
+
+    void pop()
+    {
+        mHead = (mHead + 1) % N;
+        mCount--;
+    }
+
+private:
+    std::array<T, N> mItems{};
+    size_t mHead = 0;
+    size_t mCount = 0;
+};
+
+/**
+ * @brief base of the operator descriptors accepted by '|'
+ */
+struct qshStreamOp {};
+
+/**
+ * @brief root of a pipeline description
+ */
+class qshStream
+{
+public:
+    template<typename Sink>
+    typename std::decay<Sink>::type to(Sink&& sink) const
+    {
+        return std::forward<Sink>(sink);
+    }
+};
+
+/**
+ * @brief pipeline description, an upstream description and one
+ *        more operator. Can be instantiated several times.
+ */
+template<typename Prev, typename Op>
+class qshStreamChain
+{
+public:
+    qshStreamChain(const Prev& prev, const Op& op) : mPrev(prev), mOp(op) {}
+
+    /**
+     * @brief instantiate the pipeline
+     *
+     * @param sink callable receiving the output events, stored by
+     *        value (use std::ref() to keep a reference)
+     *
+     * @return the fused pipeline, a callable taking input events
+     */
+    template<typename Sink>
+    auto to(Sink&& sink) const
+    {
+        return mPrev.to(mOp.bind(std::forward<Sink>(sink)));
+    }
+
+private:
+    Prev mPrev;
+    Op mOp;
+};
+
+template<typename T>
+struct qshIsStream : std::false_type {};
+template<>
+struct qshIsStream<qshStream> : std::true_type {};
+template<typename Prev, typename Op>
+struct qshIsStream<qshStreamChain<Prev, Op>> : std::true_type {};
+
+template<typename Prev, typename Op,
+         typename = typename std::enable_if<
+             qshIsStream<Prev>::value && std::is_base_of<qshStreamOp, Op>::value>::type>
+qshStreamChain<Prev, Op> operator|(const Prev& prev, const Op& op)
+{
+    return qshStreamChain<Prev, Op>(prev, op);
+}
+
+/* ----------------------------------------------------------------- map */
+
+template<typename F, typename Next>
+class qshMapStage
+{
+public:
+    qshMapStage(const F& fn, Next&& next) : mFn(fn), mNext(std::move(next)) {}
+
+    template<typename T>
+    void operator()(const T& event) { mNext(mFn(event)); }
+
+private:
+    F mFn;
+    Next mNext;
+};
+
+template<typename F>
+struct qshMapOp : qshStreamOp
+{
+    F fn;
+    explicit qshMapOp(const F& f) : fn(f) {}
+
+    template<typename Next>
+    qshMapStage<F, typename std::decay<Next>::type> bind(Next&& next) const
+    {
+        return qshMapStage<F, typename std::decay<Next>::type>(fn, typename std::decay<Next>::type(std::forward<Next>(next)));
+    }
+};
+
+/**
+ * @brief transform every event with fn
+ */
+template<typename F>
+qshMapOp<typename std::decay<F>::type> qshMap(F&& fn)
+{
+    return qshMapOp<typename std::decay<F>::type>(std::forward<F>(fn));
+}
+
+/* -------------------------------------------------------------- filter */
+
+template<typename F, typename Next>
+class qshFilterStage
+{
+public:
+    qshFilterStage(const F& pred, Next&& next) : mPred(pred), mNext(std::move(next)) {}
+
+    template<typename T>
+    void operator()(const T& event)
+    {
+        if (mPred(event)) {
+            mNext(event);
+        }
+    }
+
+private:
+    F mPred;
+    Next mNext;
+};
+
+template<typename F>
+struct qshFilterOp : qshStreamOp
+{
+    F pred;
+    explicit qshFilterOp(const F& p) : pred(p) {}
+
+    template<typename Next>
+    qshFilterStage<F, typename std::decay<Next>::type> bind(Next&& next) const
+    {
+        return qshFilterStage<F, typename std::decay<Next>::type>(pred, typename std::decay<Next>::type(std::forward<Next>(next)));
+    }
+};
+
+/**
+ * @brief forward only the events for which pred returns true
+ */
+template<typename F>
+qshFilterOp<typename std::decay<F>::type> qshFilter(F&& pred)
+{
+    return qshFilterOp<typename std::decay<F>::type>(std::forward<F>(pred));
+}
+
+/* ------------------------------------------------------------ decimate */
+
+template<typename Next>
+class qshDecimateStage
+{
+public:
+    qshDecimateStage(size_t factor, Next&& next)
+        : mFactor(factor > 0 ? factor : 1), mNext(std::move(next)) {}
+
+    template<typename T>
+    void operator()(const T& event)
+    {
+        if (0 == mCount) {
+            mNext(event);
+        }
+        if (++mCount == mFactor) {
+            mCount = 0;
+        }
+    }
+
+private:
+    const size_t mFactor;
+    size_t mCount = 0;
+    Next mNext;
+};
+
+struct qshDecimateOp : qshStreamOp
+{
+    size_t factor;
+    explicit qshDecimateOp(size_t f) : factor(f) {}
+
+    template<typename Next>
+    qshDecimateStage<typename std::decay<Next>::type> bind(Next&& next) const
+    {
+        return qshDecimateStage<typename std::decay<Next>::type>(factor, typename std::decay<Next>::type(std::forward<Next>(next)));
+    }
+};
+
+/**
+ * @brief forward one event out of factor, starting with the first one
+ */
+inline qshDecimateOp qshDecimate(size_t factor)
+{
+    return qshDecimateOp(factor);
+}
+
+/* -------------------------------------------------------------- window */
+
+/**
+ * @brief the events of a window, oldest first. Only valid during
+ *        the call receiving it.
+ */
+template<typename T, size_t N>
+class qshWindowView
+{
+public:
+    explicit qshWindowView(const qshStreamRing<T, N>& ring) : mRing(ring) {}
+
+    size_t size() const { return mRing.size(); }
+    const T& operator[](size_t idx) const { return mRing[idx]; }
+    const T& front() const { return mRing.front(); }
+    const T& back() const { return mRing[mRing.size() - 1]; }
+
+private:
+    const qshStreamRing<T, N>& mRing;
+};
+
+template<typename T, size_t N, typename Next>
+class qshWindowStage
+{
+public:
+    qshWindowStage(size_t step, Next&& next)
+        : mStep(step > 0 ? step : 1), mNext(std::move(next)) {}
+
+    void operator()(const T& event)
+    {
+        mRing.push(event);
+        if (++mSinceLast >= mStep && mRing.full()) {
+            mSinceLast = 0;
+            mNext(qshWindowView<T, N>(mRing));
+        }
+    }
+
+private:
+    const size_t mStep;
+    size_t mSinceLast = 0;
+    qshStreamRing<T, N> mRing;
+    Next mNext;
+};
+
+template<typename T, size_t N>
+struct qshWindowOp : qshStreamOp
+{
+    size_t step;
+    explicit qshWindowOp(size_t s) : step(s) {}
+
+    template<typename Next>
+    qshWindowStage<T, N, typename std::decay<Next>::type> bind(Next&& next) const
+    {
+        return qshWindowStage<T, N, typename std::decay<Next>::type>(step, typename std::decay<Next>::type(std::forward<Next>(next)));
+    }
+};
+
+/**
+ * @brief forward the last N events as a qshWindowView, every step
+ *        events once N events have been seen
+ *
+ * step == N gives tumbling windows, step == 1 sliding windows.
+ */
+template<typename T, size_t N>
+qshWindowOp<T, N> qshWindow(size_t step = N)
+{
+    return qshWindowOp<T, N>(step);
+}
+
+/* ------------------------------------------------------------ debounce */
+
+template<typename TsFn, typename Next>
+class qshDebounceStage
+{
+public:
+    qshDebounceStage(uint64_t intervalNs, const TsFn& tsFn, Next&& next)
+        : mIntervalNs(intervalNs), mTsFn(tsFn), mNext(std::move(next)) {}
+
+    template<typename T>
+    void operator()(const T& event)
+    {
+        uint64_t ts = mTsFn(event);
+        if (mHasLast && ts >= mLastTs && ts - mLastTs < mIntervalNs) {
+            return;
+        }
+        mHasLast = true;
+        mLastTs = ts;
+        mNext(event);
+    }
+
+private:
+    const uint64_t mIntervalNs;
+    TsFn mTsFn;
+    bool mHasLast = false;
+    uint64_t mLastTs = 0;
+    Next mNext;
+};
+
+template<typename TsFn>
+struct qshDebounceOp : qshStreamOp
+{
+    uint64_t intervalNs;
+    TsFn tsFn;
+    qshDebounceOp(uint64_t interval, const TsFn& fn) : intervalNs(interval), tsFn(fn) {}
+
+    template<typename Next>
+    qshDebounceStage<TsFn, typename std::decay<Next>::type> bind(Next&& next) const
+    {
+        return qshDebounceStage<TsFn, typename std::decay<Next>::type>(intervalNs, tsFn, typename std::decay<Next>::type(std::forward<Next>(next)));
+    }
+};
+
+/**
+ * @brief drop the events closer than intervalNs, in event time, to
+ *        the last event forwarded
+ *
+ * Time is taken from the events, so replayed or batched events are
+ * debounced like live ones. An event older than the last forwarded
+ * one (timestamp going back) is forwarded and restarts the interval.
+ */
+template<typename TsFn = qshEventTimestamp>
+qshDebounceOp<TsFn> qshDebounce(uint64_t intervalNs, const TsFn& tsFn = TsFn())
+{
+    return qshDebounceOp<TsFn>(intervalNs, tsFn);
+}
+
+/* ------------------------------------------------------ combine latest */
+
+/**
+ * @brief joins two streams: once both have produced an event, every
+ *        event of either one forwards fn(latest A, latest B)
+ *
+ * Feed it with to(combiner.left()) and to(combiner.right()). The
+ * inputs point to the combiner, which must not move while they are in
+ * use. A and B must be default constructible and copyable.
+ */
+template<typename A, typename B, typename F, typename Next>
+class qshCombineLatest
+{
+public:
+    qshCombineLatest(const F& fn, Next&& next) : mFn(fn), mNext(std::move(next)) {}
+    qshCombineLatest(const qshCombineLatest&) = delete;
+    qshCombineLatest& operator=(const qshCombineLatest&) = delete;
+
+    struct leftInput {
+        qshCombineLatest* self;
+        void operator()(const A& event) { self->onLeft(event); }
+    };
+    struct rightInput {
+        qshCombineLatest* self;
+        void operator()(const B& event) { self->onRight(event); }
+    };
+
+    leftInput left() { return leftInput{this}; }
+    rightInput right() { return rightInput{this}; }
+
+private:
+    void onLeft(const A& event)
+    {
+        mLeft = event;
+        mHasLeft = true;
+        if (mHasRight) {
+            mNext(mFn(mLeft, mRight));
+        }
+    }
+
+    void onRight(const B& event)
+    {
+        mRight = event;
+        mHasRight = true;
+        if (mHasLeft) {
+            mNext(mFn(mLeft, mRight));
+        }
+    }
+
+    F mFn;
+    A mLeft{};
+    B mRight{};
+    bool mHasLeft = false;
+    bool mHasRight = false;
+    Next mNext;
+};
+
+/**
+ * @brief create a qshCombineLatest
+ *
+ * @param fn callable taking (const A&, const B&)
+ * @param next sink or pipeline receiving the combined events
+ */
+template<typename A, typename B, typename F, typename Next>
+std::unique_ptr<qshCombineLatest<A, B, typename std::decay<F>::type, typename std::decay<Next>::type>>
+qshMakeCombineLatest(F&& fn, Next&& next)
+{
+    using type = qshCombineLatest<A, B, typename std::decay<F>::type, typename std::decay<Next>::type>;
+    return std::unique_ptr<type>(new type(std::forward<F>(fn), typename std::decay<Next>::type(std::forward<Next>(next))));
+}
+
+/* -------------------------------------------------- merge by timestamp */
+
+/**
+ * @brief merges Inputs streams of T into one, in timestamp order
+ *
+ * Each input must be in timestamp order. An event is forwarded once
+ * every input has an event pending, so that no older event can still
+ * arrive. An input which stays silent would stall the others: when
+ * the Capacity events pending on an input are full, the oldest
+ * pending event is forwarded anyway, which bounds the added latency.
+ * flush() forwards everything pending, e.g. when a stream stops.
+ *
+ * Feed it with to(merger.input(idx)). The inputs point to the merger,
+ * which must not move while they are in use.
+ */
+template<typename T, size_t Inputs, size_t Capacity, typename TsFn, typename Next>
+class qshMergeByTimestamp
+{
+public:
+    static_assert(Inputs > 0, "merge needs at least one input");
+
+    qshMergeByTimestamp(const TsFn& tsFn, Next&& next) : mTsFn(tsFn), mNext(std::move(next)) {}
+    qshMergeByTimestamp(const qshMergeByTimestamp&) = delete;
+    qshMergeByTimestamp& operator=(const qshMergeByTimestamp&) = delete;
+
+    struct mergeInput {
+        qshMergeByTimestamp* self;
+        size_t idx;
+        void operator()(const T& event) { self->push(idx, event); }
+    };
+
+    mergeInput input(size_t idx) { return mergeInput{this, idx % Inputs}; }
+
+    void flush()
+    {
+        while (emitOldest()) {
+        }
+    }
+
+private:
+    void push(size_t idx, const T& event)
+    {
+        while (mPending[idx].full()) {
+            emitOldest();
+        }
+        mPending[idx].push(event);
+        while (allPending()) {
+            emitOldest();
+        }
+    }
+
+    bool allPending() const
+    {
+        for (const auto& pending : mPending) {
+            if (pending.empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool emitOldest()
+    {
+        size_t oldest = Inputs;
+        uint64_t oldestTs = 0;
+        for (size_t idx = 0; idx < Inputs; idx++) {
+            if (mPending[idx].empty()) {
+                continue;
+            }
+            uint64_t ts = mTsFn(mPending[idx].front());
+            if (Inputs == oldest || ts < oldestTs) {
+                oldest = idx;
+                oldestTs = ts;
+            }
+        }
+        if (Inputs == oldest) {
+            return false;
+        }
+        mNext(mPending[oldest].front());
+        mPending[oldest].pop();
+        return true;
+    }
+
+    TsFn mTsFn;
+    std::array<qshStreamRing<T, Capacity>, Inputs> mPending;
+    Next mNext;
+};
+
+/**
+ * @brief create a qshMergeByTimestamp
+ *
+ * @param next sink or pipeline receiving the merged events
+ * @param tsFn timestamp accessor of the events
+ */
+template<typename T, size_t Inputs, size_t Capacity = 16, typename Next,
+         typename TsFn = qshEventTimestamp>
+std::unique_ptr<qshMergeByTimestamp<T, Inputs, Capacity, TsFn, typename std::decay<Next>::type>>
+qshMakeMergeByTimestamp(Next&& next, const TsFn& tsFn = TsFn())
+{
+    using type = qshMergeByTimestamp<T, Inputs, Capacity, TsFn, typename std::decay<Next>::type>;
+    return std::unique_ptr<type>(new type(tsFn, typename std::decay<Next>::type(std::forward<Next>(next))));
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief failure bits returned by qshApplyThreadAttr()
+ */
+#define QSH_THREAD_ATTR_OK                0
+#define QSH_THREAD_ATTR_AFFINITY_FAILED   (1 << 0)
+#define QSH_THREAD_ATTR_SCHED_FAILED      (1 << 1)
+#define QSH_THREAD_ATTR_STACK_LOCK_FAILED (1 << 2)
+#define QSH_THREAD_ATTR_UNSUPPORTED       (1 << 3)
+
+/**
+ * @brief Scheduling attributes of a thread
+ *
+ * Every attribute is optional, the defaults leave the thread as it is.
+ */
+struct qshThreadAttr
+{
+    /* CPUs the thread may run on, empty to keep the current mask */
+    std::vector<int> cpus;
+    /* SCHED_OTHER, SCHED_FIFO or SCHED_RR, -1 to keep the current policy */
+    int policy = -1;
+    /* priority for SCHED_FIFO/SCHED_RR, ignored for SCHED_OTHER */
+    int priority = 0;
+    /* bytes of stack, from its top, to lock in memory (and fault in
+       right away), 0 to leave the stack pageable */
+    size_t lockStackBytes = 0;
+};
+
+#ifndef _WIN32
+/**
+ * @brief apply scheduling attributes to a thread
+ *
+ * All attributes are attempted, even if one fails. Each failure is
+ * logged with its reason (typically missing CAP_SYS_NICE or
+ * CAP_IPC_LOCK, or a CPU not present on this target).
+ *
+ * @param thread thread to configure
+ * @param attr attributes to apply
+ * @param name thread name, for logs
+ *
+ * @return QSH_THREAD_ATTR_OK, or an OR of the QSH_THREAD_ATTR_*
+ *         bits of the attributes which could not be applied
+ */
+int qshApplyThreadAttr(pthread_t thread, const qshThreadAttr& attr, const char* name);
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include "qshWorker.h"
+
+/**
+ * Work-stealing thread pool.
+ *
+ * Every pool thread owns a task queue. Tasks posted from a pool thread
+ * go to that thread's queue, tasks posted from outside the pool go to
+ * a shared injection queue, and tasks carrying an affinity hint go to
+ * the queue of the hinted thread. An idle thread first serves its own
+ * queue, then the injection queue, then steals from the other threads,
+ * so a few threads keep all cores busy without one thread per
+ * subsystem.
+ *
+ * Tasks posted to the pool may run concurrently and in any order, use
+ * qshPoolWorker for ordered execution.
+ */
+class qshThreadPool
+{
+public:
+    static constexpr int NO_AFFINITY = -1;
+
+    /**
+     * @brief creates the pool threads and starts processing tasks
+     *
+     * @param numThreads number of threads, 0 for one per core
+     */
+    explicit qshThreadPool(size_t numThreads = 0);
+
+    /**
+     * @brief stops the pool, see shutdown()
+     *
+     * @note every qshPoolWorker using this pool must be destroyed
+     *       first, and this must not be called from a pool thread.
+     */
+    ~qshThreadPool();
+
+    /**
+     * @brief stops the pool threads, waits until they complete
+     *        their current task. Queued tasks are dropped.
+     */
+    void shutdown();
+
+    /**
+     * @brief number of threads in the pool
+     */
+    size_t size() const { return mQueues.size(); }
+
+    /**
+     * @brief apply scheduling attributes to pool threads
+     *
+     * @param attr attributes to apply
+     * @param threadIdx pool thread to configure, -1 for all of them.
+     *        Combined with the affinity hint of addTask(), this pins
+     *        a class of tasks to given cores.
+     *
+     * @return QSH_THREAD_ATTR_OK, or the QSH_THREAD_ATTR_* bits of
+     *         the attributes which could not be applied to at least
+     *         one thread
+     */
+    int setThreadAttr(const qshThreadAttr& attr, int threadIdx = -1);
+
+    /**
+     * @brief add a new task for the pool to do
+     *
+     * @param task task to perform
+     * @param affinity index of the pool thread which should preferably
+     *        run the task (modulo the pool size), e.g. to keep tasks
+     *        touching the same data on the same core. Other threads
+     *        may still steal it when idle.
+     *
+     * @return false if the pool is shutting down, true otherwise
+     */
+    bool addTask(const workerTask& task, int affinity = NO_AFFINITY)
+    {
+        if (nullptr == task) {
+            return false;
+        }
+        return addTask(workerInplaceTask(task), affinity);
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerInplaceTask>::value &&
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    bool addTask(F&& task, int affinity = NO_AFFINITY)
+    {
+        return addTask(makeWorkerTask(std::forward<F>(task)), affinity);
+    }
+
+    bool addTask(workerInplaceTask&& task, int affinity = NO_AFFINITY);
+
+private:
+    struct taskQueue {
+        std::mutex mutex;
+        qshTaskRing tasks;
+    };
+
+    void run(size_t index);
+    bool takeTask(size_t index, workerInplaceTask& task);
+    bool popFrom(taskQueue& queue, workerInplaceTask& task);
+
+    std::atomic<bool> mAlive;
+    std::vector<std::unique_ptr<taskQueue>> mQueues;
+    taskQueue mInjection;
+    /* number of queued tasks, over all queues */
+    std::atomic<size_t> mPending{0};
+    std::atomic<size_t> mSleepers{0};
+    std::mutex mSleepMutex;
+    std::condition_variable mSleepCv;
+    std::vector<std::thread> mThreads;
+};
+
+/**
+ * qshWorker-compatible facade running its tasks on a qshThreadPool.
+ *
+ * Tasks added to one qshPoolWorker run one at a time, in the order in
+ * which they are added, like on a qshWorker, but on whichever pool
+ * thread is available instead of a dedicated thread. Existing
+ * qshWorker users can switch by constructing a qshPoolWorker instead.
+ */
+class qshPoolWorker
+{
+public:
+    /**
+     * @param pool pool running the tasks, must outlive this worker
+     * @param affinity preferred pool thread, see qshThreadPool::addTask()
+     */
+    explicit qshPoolWorker(qshThreadPool& pool, int affinity = qshThreadPool::NO_AFFINITY);
+
+    /**
+     * @brief shuts the worker down
+     *
+     * @note this destructor should never be called from a task of
+     *       this worker.
+     */
+    ~qshPoolWorker();
+
+    /**
+     * @brief stops processing tasks, waits until the task currently
+     *        running completes. Queued tasks are dropped.
+     */
+    void shutdownWorker();
+
+    /**
+     * @brief kept for qshWorker compatibility, the name is only used
+     *        in logs since pool threads are shared
+     */
+    void setName(const char *name);
+
+    /**
+     * @brief add a new task for the worker to do
+     *
+     * Tasks are performed in order in which they are added
+     *
+     * @param task task to perform
+     */
+    void addTask(const workerTask& task)
+    {
+        if (nullptr == task) {
+            return;
+        }
+        addTask(workerInplaceTask(task));
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerInplaceTask>::value &&
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    void addTask(F&& task)
+    {
+        addTask(makeWorkerTask(std::forward<F>(task)));
+    }
+
+    void addTask(workerInplaceTask&& task);
+
+private:
+    /* tasks run per pool visit, before yielding the pool thread */
+    static constexpr int DRAIN_BATCH = 16;
+
+    struct strand {
+        std::mutex mutex;
+        std::condition_variable idle;
+        qshTaskRing tasks;
+        bool alive = true;
+        bool scheduled = false;
+        bool running = false;
+        char name[16] = "poolworker";
+    };
+
+    static void schedule(qshThreadPool* pool, int affinity, const std::shared_ptr<strand>& s);
+    static void drain(qshThreadPool* pool, int affinity, const std::shared_ptr<strand>& s);
+
+    qshThreadPool& mPool;
+    const int mAffinity;
+    std::shared_ptr<strand> mStrand;
+};
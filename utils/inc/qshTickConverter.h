@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Exact integer conversion between two clock rates
+ *
+ * Converts a count of a clock running at fromFreq to the count of a
+ * clock running at toFreq, i.e. floor(value * toFreq / fromFreq),
+ * without division or floating point on the conversion path:
+ *
+ *     value * toFreq / fromFreq = value * q + value * r / fromFreq
+ *
+ * with q = toFreq / fromFreq and r = toFreq % fromFreq. The fraction
+ * r / fromFreq is precomputed as a 128-bit fixed-point multiplier
+ * rounded up, whose error (below value / 2^128) never reaches the
+ * 1 / fromFreq granularity of the exact result, so the conversion is
+ * exact for every 64-bit value (the result wraps past 2^64).
+ *
+ * Everything is constexpr, so a converter between two frequencies
+ * known at build time folds to constants.
+ */
+class qshTickConverter
+{
+public:
+    constexpr qshTickConverter(uint64_t fromFreq, uint64_t toFreq)
+    {
+        if (0 == fromFreq) {
+            fromFreq = 1;
+        }
+        mMult = toFreq / fromFreq;
+        uint64_t rem = toFreq % fromFreq;
+        /* fraction = ceil(rem * 2^128 / fromFreq), rem < fromFreq */
+        uint64_t carry = 0;
+        mFracHi = div128(rem, 0, fromFreq, carry);
+        mFracLo = div128(carry, 0, fromFreq, carry);
+        if (0 != carry) {
+            if (0 == ++mFracLo) {
+                mFracHi++;
+            }
+        }
+    }
+
+    /**
+     * @brief convert one value
+     */
+    constexpr uint64_t convert(uint64_t value) const
+    {
+        if (0 == (mFracHi | mFracLo)) {
+            return value * mMult;
+        }
+        /* top 64 bits of the 192-bit value * fraction */
+        uint64_t midHi = 0;
+        uint64_t midLo = mul64(value, mFracHi, midHi);
+        uint64_t loHi = 0;
+        mul64(value, mFracLo, loHi);
+        uint64_t sum = midLo + loHi;
+        uint64_t frac = midHi + (sum < midLo ? 1 : 0);
+        return value * mMult + frac;
+    }
+
+    /**
+     * @brief convert an array of values
+     *
+     * The loop has no branch nor division and keeps its constants in
+     * registers. It stays scalar: SIMD units (NEON, SSE/AVX2) have no
+     * 64x64->128 bit multiply to vectorize it with.
+     *
+     * @param in values to convert
+     * @param out converted values, may be the same array as in
+     * @param count number of values
+     */
+    void convert(const uint64_t* in, uint64_t* out, size_t count) const
+    {
+        const uint64_t mult = mMult;
+        const uint64_t fracHi = mFracHi;
+        const uint64_t fracLo = mFracLo;
+        for (size_t idx = 0; idx < count; idx++) {
+            uint64_t value = in[idx];
+            uint64_t midHi;
+            uint64_t midLo = mul64(value, fracHi, midHi);
+            uint64_t loHi;
+            mul64(value, fracLo, loHi);
+            uint64_t sum = midLo + loHi;
+            out[idx] = value * mult + midHi + (sum < midLo ? 1 : 0);
+        }
+    }
+
+private:
+    /* 64x64 -> 128 bit multiply, returns the low half */
+    static constexpr uint64_t mul64(uint64_t a, uint64_t b, uint64_t& hi)
+    {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 product = (unsigned __int128)a * b;
+        hi = uint64_t(product >> 64);
+        return uint64_t(product);
+#else
+        uint64_t aLo = a & 0xffffffffull, aHi = a >> 32;
+        uint64_t bLo = b & 0xffffffffull, bHi = b >> 32;
+        uint64_t lolo = aLo * bLo;
+        uint64_t hilo = aHi * bLo;
+        uint64_t lohi = aLo * bHi;
+        uint64_t hihi = aHi * bHi;
+        uint64_t cross = (lolo >> 32) + (hilo & 0xffffffffull) + lohi;
+        hi = hihi + (hilo >> 32) + (cross >> 32);
+        return (cross << 32) | (lolo & 0xffffffffull);
+#endif
+    }
+
+    /* (hi:lo) / div with hi < div, returns the quotient (fits in 64
+       bits) and the remainder in rem. Only used at construction. */
+    static constexpr uint64_t div128(uint64_t hi, uint64_t lo, uint64_t div, uint64_t& rem)
+    {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 num = ((unsigned __int128)hi << 64) | lo;
+        rem = uint64_t(num % div);
+        return uint64_t(num / div);
+#else
+        uint64_t quot = 0;
+        for (int bit = 63; bit >= 0; bit--) {
+            bool overflow = 0 != (hi >> 63);
+            hi = (hi << 1) | ((lo >> bit) & 1);
+            quot <<= 1;
+            if (overflow || hi >= div) {
+                hi -= div;
+                quot |= 1;
+            }
+        }
+        rem = hi;
+        return quot;
+#endif
+    }
+
+    uint64_t mMult = 0;
+    uint64_t mFracHi = 0;
+    uint64_t mFracLo = 0;
+};
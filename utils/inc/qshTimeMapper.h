@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "qshSeqlock.h"
+
+/**
+ * @brief Linear mapping from a source clock to a target clock
+ *
+ * target = source + offsetNs + slope * (source - epochNs)
+ */
+struct qshTimeMapping
+{
+    /* target - source at epochNs */
+    int64_t offsetNs = 0;
+    /* rate of change of the offset, in ns per source ns */
+    double slope = 0.0;
+    /* source time the mapping is anchored at */
+    uint64_t epochNs = 0;
+
+    int64_t toTarget(uint64_t sourceNs) const
+    {
+        int64_t delta = int64_t(sourceNs - epochNs);
+        return int64_t(sourceNs) + offsetNs + int64_t(double(delta) * slope);
+    }
+
+    uint64_t toSource(int64_t targetNs) const
+    {
+        int64_t delta = targetNs - offsetNs - int64_t(epochNs);
+        return epochNs + uint64_t(int64_t(double(delta) / (1.0 + slope)));
+    }
+
+    /**
+     * @brief convert an array of source times with this mapping
+     *
+     * The loop is branch free so the compiler can vectorize it.
+     * @param sourceNs source times
+     * @param targetNs converted times
+     * @param count number of values
+     */
+    void toTarget(const uint64_t* sourceNs, int64_t* targetNs, size_t count) const
+    {
+        const uint64_t epoch = epochNs;
+        const int64_t offset = offsetNs;
+        const double rate = slope;
+        for (size_t idx = 0; idx < count; idx++) {
+            int64_t delta = int64_t(sourceNs[idx] - epoch);
+            targetNs[idx] = int64_t(sourceNs[idx]) + offset + int64_t(double(delta) * rate);
+        }
+    }
+
+    /* target - source at a given source time */
+    int64_t offsetAt(uint64_t sourceNs) const
+    {
+        return offsetNs + int64_t(double(int64_t(sourceNs - epochNs)) * slope);
+    }
+};
+
+/**
+ * @brief Drift-aware estimate of the mapping between two clocks
+ *
+ * Fed with paired readings of both clocks, it fits offset and rate by
+ * least squares over the last HISTORY samples. A new estimate is not
+ * applied as a step: the published mapping stays continuous, and its
+ * slope is biased to absorb the error over the given slew period
+ * (at most MAX_SLEW), so converted timestamps never jump and stay
+ * monotonic. Only errors above STEP_THRESHOLD_NS (clock set, first
+ * sample) are applied as a step.
+ *
+ * Conversions read the mapping through a seqlock: they never block
+ * and always see a consistent {offset, slope, epoch}. Samples must be
+ * added by one thread at a time.
+ */
+class qshTimeMapper
+{
+public:
+    static constexpr size_t HISTORY = 8;
+    static constexpr double MAX_SLEW = 500e-6;
+    static constexpr int64_t STEP_THRESHOLD_NS = 5000000;
+
+    /**
+     * @brief add a paired reading of both clocks and publish the
+     *        updated mapping
+     *
+     * @param sourceNs source clock reading
+     * @param targetNs target clock reading, taken at the same time
+     * @param slewPeriodNs time over which the estimation error is
+     *        absorbed, typically the interval between samples
+     *
+     * @return true if the mapping was stepped, false if it was slewed
+     */
+    bool addSample(uint64_t sourceNs, int64_t targetNs, uint64_t slewPeriodNs)
+    {
+        int64_t offset = targetNs - int64_t(sourceNs);
+        if (0 != mCount && sourceNs <= mSamples[newest()].sourceNs) {
+            /* the source clock never goes back, start over */
+            mCount = 0;
+        }
+        mSamples[(mFirst + mCount) % HISTORY] = sample{sourceNs, offset};
+        if (mCount < HISTORY) {
+            mCount++;
+        } else {
+            mFirst = (mFirst + 1) % HISTORY;
+        }
+
+        double rate = 0.0, residual = 0.0;
+        int64_t fitted = fit(rate, residual);
+        qshTimeMapping current = mMapping.load();
+        int64_t error = fitted - current.offsetAt(sourceNs);
+        qshTimeMapping next;
+        next.epochNs = sourceNs;
+        bool step = !mValid || error > STEP_THRESHOLD_NS || error < -STEP_THRESHOLD_NS;
+        if (step) {
+            /* the history does not describe the new offset */
+            mFirst = (mFirst + mCount - 1) % HISTORY;
+            mCount = 1;
+            next.offsetNs = offset;
+            next.slope = 0.0;
+        } else {
+            double slew = (0 != slewPeriodNs) ? double(error) / double(slewPeriodNs) : 0.0;
+            if (slew > MAX_SLEW) {
+                slew = MAX_SLEW;
+            } else if (slew < -MAX_SLEW) {
+                slew = -MAX_SLEW;
+            }
+            next.offsetNs = current.offsetAt(sourceNs);
+            next.slope = rate + slew;
+        }
+        mValid = true;
+        mRate = step ? 0.0 : rate;
+        mResidualNs = step ? 0.0 : residual;
+        mMapping.store(next);
+        return step;
+    }
+
+    /**
+     * @brief forget the history and map through the given reading
+     */
+    void reset(uint64_t sourceNs, int64_t targetNs)
+    {
+        mCount = 0;
+        mValid = false;
+        addSample(sourceNs, targetNs, 0);
+    }
+
+    /**
+     * @brief current mapping, wait-free for readers
+     */
+    qshTimeMapping get() const { return mMapping.load(); }
+
+    int64_t toTarget(uint64_t sourceNs) const { return mMapping.load().toTarget(sourceNs); }
+    uint64_t toSource(int64_t targetNs) const { return mMapping.load().toSource(targetNs); }
+
+    /**
+     * @brief drift of the target clock against the source clock, as
+     *        fitted (without the slew), in ns per source ns
+     */
+    double getRate() const { return mRate; }
+
+    /**
+     * @brief root mean square of the offset samples around the fit,
+     *        in ns (0 with less than 3 samples)
+     */
+    double getResidualNs() const { return mResidualNs; }
+
+private:
+    struct sample {
+        uint64_t sourceNs;
+        int64_t offsetNs;
+    };
+
+    size_t newest() const { return (mFirst + mCount - 1) % HISTORY; }
+
+    /* least squares offset at the newest sample, relative to it for
+       precision, rate of the offset and residual of the fit */
+    int64_t fit(double& rate, double& residual) const
+    {
+        const sample& last = mSamples[newest()];
+        rate = 0.0;
+        residual = 0.0;
+        if (mCount < 2) {
+            return last.offsetNs;
+        }
+        double meanX = 0.0, meanY = 0.0;
+        for (size_t idx = 0; idx < mCount; idx++) {
+            const sample& s = mSamples[(mFirst + idx) % HISTORY];
+            meanX += double(int64_t(s.sourceNs - last.sourceNs));
+            meanY += double(s.offsetNs - last.offsetNs);
+        }
+        meanX /= double(mCount);
+        meanY /= double(mCount);
+        double sxx = 0.0, sxy = 0.0;
+        for (size_t idx = 0; idx < mCount; idx++) {
+            const sample& s = mSamples[(mFirst + idx) % HISTORY];
+            double dx = double(int64_t(s.sourceNs - last.sourceNs)) - meanX;
+            double dy = double(s.offsetNs - last.offsetNs) - meanY;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if (sxx > 0.0) {
+            rate = sxy / sxx;
+        }
+        if (mCount > 2) {
+            double sum = 0.0;
+            for (size_t idx = 0; idx < mCount; idx++) {
+                const sample& s = mSamples[(mFirst + idx) % HISTORY];
+                double dx = double(int64_t(s.sourceNs - last.sourceNs)) - meanX;
+                double dy = double(s.offsetNs - last.offsetNs) - meanY;
+                sum += (dy - rate * dx) * (dy - rate * dx);
+            }
+            residual = std::sqrt(sum / double(mCount - 2));
+        }
+        return last.offsetNs + int64_t(meanY - rate * meanX);
+    }
+
+    qshSeqlock<qshTimeMapping> mMapping;
+    sample mSamples[HISTORY] = {};
+    size_t mFirst = 0;
+    size_t mCount = 0;
+    bool mValid = false;
+    double mRate = 0.0;
+    double mResidualNs = 0.0;
+};
@@ -4,25 +4,69 @@
  */
 
 #pragma once
-/* This is platform specific code, so make sure that we are compiling
-   for correct architecture */
-#if defined(__aarch64__)
-#define TARGET_ARM64
-#elif defined(__arm__)
-#define TARGET_ARM
-#else
-#error "target cpu architecture not supported"
-#endif
 #include <cstdint>
 #include <cinttypes>
 #include <atomic>
 #include <limits>
+#include <mutex>
 #ifdef __ANDROID_API__
 #include "utils/SystemClock.h"
-#else
-#include <time.h>
 #endif
+#include <time.h>
 #include "qshLog.h"
+#include "qshClockSource.h"
+#include "qshTickConverter.h"
+#include "qshTimeMapper.h"
+#include "qshTimestamp.h"
+
+/**
+ * @brief host clock qtimer timestamps are converted to
+ */
+enum class qshTargetClock
+{
+    DEFAULT,    /* elapsedRealtimeNano() on android, CLOCK_REALTIME otherwise */
+    BOOTTIME,   /* CLOCK_BOOTTIME, monotonic and counting in suspend */
+    MONOTONIC,  /* CLOCK_MONOTONIC, monotonic, stopped in suspend */
+    REALTIME,   /* CLOCK_REALTIME, wall clock, follows time sync */
+};
+
+/**
+ * @brief clock domain of the timestamps converted to a target clock
+ *
+ * Every target clock has a domain of its own, even when two of them
+ * read the same host clock (DEFAULT and REALTIME off android), so the
+ * typed timestamps of instances targeting different clocks never mix.
+ */
+constexpr qshClockDomain qshTargetDomain(qshTargetClock targetClock)
+{
+    return (qshTargetClock::BOOTTIME == targetClock) ? qshClockDomain::BOOTTIME :
+           (qshTargetClock::MONOTONIC == targetClock) ? qshClockDomain::MONOTONIC :
+           (qshTargetClock::REALTIME == targetClock) ? qshClockDomain::WALLCLOCK :
+           qshClockDomain::REALTIME;
+}
+
+/**
+ * @brief Result of one synchronization of the qtimer to android
+ *        time mapping
+ */
+struct qshTimeSyncSample
+{
+    /* qtimer time (in ns) of the clock reading */
+    uint64_t qtimerNs = 0;
+    /* android time (in ns) of the clock reading */
+    int64_t realtimeNs = 0;
+    /* qtimer time spent reading the android time, bounds the
+       error of the reading */
+    uint64_t gapNs = 0;
+    /* true if the mapping was stepped instead of slewed */
+    bool stepped = false;
+    /* offset of the mapping after the update */
+    int64_t offsetNs = 0;
+    /* fitted drift of android time against qtimer, ns per ns */
+    double rate = 0.0;
+    /* rms of the recent readings around the fit, in ns */
+    double residualNs = 0.0;
+};
 
 /**
  * @brief Sensors time utilities
@@ -31,6 +75,18 @@
  *  - reading QTimer ticks/frequency and timestamps
  *  - converting QTimer timestamps to android system clock
  *    timestamps and vice versa.
+ *
+ * Ticks come from a qshClockSource: the QTimer on the device, the TSC
+ * or clock_gettime() on hosts, see qshClockSource.
+ *
+ * The "android" clock is the target clock of the instance (see
+ * qshTargetClock). getInstance() targets the default clock; other
+ * instances can target another clock side by side, e.g. a monotonic
+ * clock for fusion code on Linux hosts, where the default wall clock
+ * follows NTP slews and jumps.
+ *
+ * Timestamps here are raw integers, typed timestamps are converted by
+ * qshTimeUtilT, which has the target clock in its type.
  */
 class qshTimeUtil
 {
@@ -40,10 +96,42 @@ public:
      * @brief get singleton instance of the timeutil class
      * @return qshTimeUtil&
      */
-    static qshTimeUtil& getInstance()
+    static qshTimeUtil& getInstance();
+
+    /**
+     * @brief create an instance converting to the given clock
+     *
+     * Each instance keeps its own mapping. Prefer getInstance() for
+     * the default clock.
+     * @param targetClock host clock to convert qtimer timestamps to
+     */
+    explicit qshTimeUtil(qshTargetClock targetClock = qshTargetClock::DEFAULT) :
+        mTargetClock(resolveTargetClock(targetClock)),
+        mQtimerFreq(qtimerGetFreq()),
+        mTicksToNs(mQtimerFreq, NSEC_PER_SEC),
+        mNsToTicks(NSEC_PER_SEC, mQtimerFreq)
     {
-        static qshTimeUtil inst;
-        return inst;
+        mLastRealtimeNs = readRealtimeNs();
+        uint64_t qtimerNs = 0, gapNs = 0;
+        int64_t realtimeNs = 0;
+        if (sampleClocks(qtimerNs, realtimeNs, gapNs)) {
+            mMapper.reset(qtimerNs, realtimeNs);
+        } else {
+            mMapper.reset(qtimerGetTimeNs(), mLastRealtimeNs);
+        }
+        mOffsetNs = mMapper.get().offsetNs;
+    }
+    ~qshTimeUtil() = default;
+    qshTimeUtil(const qshTimeUtil&) = delete;
+    qshTimeUtil& operator=(const qshTimeUtil&) = delete;
+
+    /**
+     * @brief get the host clock this instance converts to
+     * @return qshTargetClock
+     */
+    qshTargetClock getTargetClock() const
+    {
+        return mTargetClock;
     }
 
     /**
@@ -52,18 +140,7 @@ public:
      */
     uint64_t qtimerGetTicks()
     {
-    #if defined(TARGET_ARM64)
-        unsigned long long val = 0;
-        asm volatile("mrs %0, cntvct_el0" : "=r" (val));
-        return val;
-    #else
-        uint64_t val;
-        unsigned long lsb = 0, msb = 0;
-        asm volatile("mrrc p15, 1, %[lsb], %[msb], c14"
-                     : [lsb] "=r" (lsb), [msb] "=r" (msb));
-        val = ((uint64_t)msb << 32) | lsb;
-        return val;
-    #endif
+        return mClock.getTicks();
     }
 
     /**
@@ -72,15 +149,16 @@ public:
      */
     uint64_t qtimerGetFreq()
     {
-    #if defined(TARGET_ARM64)
-        uint64_t val = 0;
-        asm volatile("mrs %0, cntfrq_el0" : "=r" (val));
-        return val;
-    #else
-        uint32_t val = 0;
-        asm volatile("mrc p15, 0, %[val], c14, c0, 0" : [val] "=r" (val));
-        return val;
-    #endif
+        return mClock.getFreq();
+    }
+
+    /**
+     * @brief get the type of the clock source providing the ticks
+     * @return qshClockSourceType
+     */
+    qshClockSourceType getClockSourceType() const
+    {
+        return mClock.getType();
     }
 
     /**
@@ -95,11 +173,22 @@ public:
     /**
      * @brief convert the qtimer tick value of nanoseconds
      * @param ticks
-     * @return uint64_t qtimer time in nanoseconds
+     * @return uint64_t qtimer time in nanoseconds, exact (rounded down)
      */
     uint64_t qtimerTicksToNs(uint64_t ticks)
     {
-        return uint64_t(double(ticks) * (double(NSEC_PER_SEC) / double(mQtimerFreq)));
+        return mTicksToNs.convert(ticks);
+    }
+
+    /**
+     * @brief convert an array of qtimer tick values to nanoseconds
+     * @param ticks tick values
+     * @param ns converted values, may be the same array as ticks
+     * @param count number of values
+     */
+    void qtimerTicksToNs(const uint64_t* ticks, uint64_t* ns, size_t count)
+    {
+        mTicksToNs.convert(ticks, ns, count);
     }
 
     /**
@@ -110,13 +199,36 @@ public:
      */
     int64_t qtimerNsToElapsedRealtimeNano(uint64_t qtimerTS)
     {
-        int64_t realtimeNs = int64_t(qtimerTS) + mOffsetNs;
+        int64_t realtimeNs = mMapper.toTarget(qtimerTS);
         if (updateQtimerToRealtimeOffset(realtimeNs)) {
-            realtimeNs = int64_t(qtimerTS) + mOffsetNs;
+            realtimeNs = mMapper.toTarget(qtimerTS);
         }
         return realtimeNs;
     }
 
+    /**
+     * @brief convert an array of qtimer timestamps (in ns) to
+     *        android system time (in ns)
+     *
+     * Meant for batched deliveries: the offset update check runs once
+     * for the whole batch, then every timestamp is converted with the
+     * same snapshot of the mapping, so samples of one batch are never
+     * split across two mappings.
+     * @param qtimerTS qtimer timestamps (in ns)
+     * @param realtimeNs converted timestamps
+     * @param count number of timestamps
+     */
+    void qtimerNsToElapsedRealtimeNano(const uint64_t* qtimerTS, int64_t* realtimeNs,
+                                       size_t count)
+    {
+        if (0 == count) {
+            return;
+        }
+        updateQtimerToRealtimeOffset(mMapper.toTarget(qtimerTS[count - 1]));
+        qshTimeMapping mapping = mMapper.get();
+        mapping.toTarget(qtimerTS, realtimeNs, count);
+    }
+
     /**
      * @brief convert android system time (in ns) to qtimer
      *        timestamp (in ns)
@@ -126,7 +238,7 @@ public:
     uint64_t elapsedRealtimeNanoToQtimerNs(int64_t androidTS)
     {
         updateQtimerToRealtimeOffset(androidTS);
-        return (androidTS - mOffsetNs);
+        return mMapper.toSource(androidTS);
     }
 
     /**
@@ -139,6 +251,30 @@ public:
     {
         return qtimerNsToElapsedRealtimeNano(qtimerTicksToNs(qtimerTicks));
     }
+
+    /**
+     * @brief convert an array of qtimer timestamps (in ticks) to
+     *        android timestamps (in ns), with one mapping for the
+     *        whole batch (see the ns variant)
+     * @param qtimerTicks qtimer timestamps (in ticks)
+     * @param realtimeNs converted timestamps
+     * @param count number of timestamps
+     */
+    void qtimerTicksToElapsedRealtimeNano(const uint64_t* qtimerTicks, int64_t* realtimeNs,
+                                          size_t count)
+    {
+        if (0 == count) {
+            return;
+        }
+        updateQtimerToRealtimeOffset(mMapper.toTarget(qtimerTicksToNs(qtimerTicks[count - 1])));
+        qshTimeMapping mapping = mMapper.get();
+        uint64_t ns[BATCH_CHUNK];
+        for (size_t first = 0; first < count; first += BATCH_CHUNK) {
+            size_t chunk = (count - first < BATCH_CHUNK) ? count - first : BATCH_CHUNK;
+            mTicksToNs.convert(qtimerTicks + first, ns, chunk);
+            mapping.toTarget(ns, realtimeNs + first, chunk);
+        }
+    }
     /**
      * @brief get offset between sensor time system and Android time system (in ns)
      * @return int64_t
@@ -148,6 +284,18 @@ public:
         return mOffsetNs;
     }
 
+    /**
+     * @brief get the current qtimer to android time mapping
+     *
+     * The mapping includes the estimated drift between both clocks,
+     * it is read without blocking and is always consistent.
+     * @return qshTimeMapping
+     */
+    qshTimeMapping getTimeMapping() const
+    {
+        return mMapper.get();
+    }
+
     /**
      * @brief kick in the logic to recalculate offset for drift
      * @param force_update if true, always update the offset (even if the
@@ -158,13 +306,7 @@ public:
 
     bool recalculateOffset(bool forceUpdate)
     {
-#ifdef __ANDROID_API__
-       return updateQtimerToRealtimeOffset(android::elapsedRealtimeNano(), forceUpdate);
-#else
-       struct timespec timeElapsed;
-       clock_gettime(CLOCK_REALTIME, &timeElapsed);
-       return updateQtimerToRealtimeOffset((uint64_t)(timeElapsed.tv_sec*NSEC_PER_SEC+timeElapsed.tv_nsec), forceUpdate);
-#endif
+       return updateQtimerToRealtimeOffset(readRealtimeNs(), forceUpdate);
     }
 
     uint64_t getOffsetUpdateScheduleNs() const
@@ -172,10 +314,142 @@ public:
        return OFFSET_UPDATE_SCHEDULE_NS;
     }
 
+    /**
+     * @brief let an external service (see qshClockSync) keep the
+     *        mapping up to date
+     *
+     * While enabled, conversions never sample the clocks and are pure
+     * reads of the mapping. recalculateOffset(true) still updates it.
+     * @param enabled
+     */
+    void setExternalSync(bool enabled)
+    {
+        mExternalSync = enabled;
+    }
+
+    bool isExternalSync() const
+    {
+        return mExternalSync;
+    }
+
+    /**
+     * @brief sample both clocks and update the mapping with the reading
+     * @param sample filled with the reading and the updated estimate
+     * @param slewPeriodNs time over which the estimation error is
+     *        absorbed, typically the interval between two syncs
+     * @return bool false if no valid reading could be taken, or if
+     *         another thread is updating the mapping
+     */
+    bool syncOffset(qshTimeSyncSample& sample, uint64_t slewPeriodNs)
+    {
+        if (!updateMapping(sample, slewPeriodNs)) {
+            return false;
+        }
+        mLastRealtimeNs = sample.realtimeNs;
+        return true;
+    }
+
 private:
+    /* adds the typed timestamps of the target clock */
+    template<qshTargetClock Target> friend class qshTimeUtilT;
+
+    /**
+     * @brief read the android time (in ns)
+     */
+    int64_t readRealtimeNs() const
+    {
+        clockid_t clock;
+        switch (mTargetClock) {
+#ifdef CLOCK_BOOTTIME
+        case qshTargetClock::BOOTTIME:
+            clock = CLOCK_BOOTTIME;
+            break;
+#endif
+        case qshTargetClock::MONOTONIC:
+            clock = CLOCK_MONOTONIC;
+            break;
+        case qshTargetClock::REALTIME:
+            clock = CLOCK_REALTIME;
+            break;
+        default:
+#ifdef __ANDROID_API__
+            return android::elapsedRealtimeNano();
+#else
+            clock = CLOCK_REALTIME;
+            break;
+#endif
+        }
+        struct timespec timeElapsed;
+        clock_gettime(clock, &timeElapsed);
+        return (int64_t)(timeElapsed.tv_sec*NSEC_PER_SEC+timeElapsed.tv_nsec);
+    }
+
+    /**
+     * @brief read qtimer and android time as close together as
+     *        possible, keeping the pair with the smallest qtimer gap
+     * @param qtimerNs qtimer time (in ns), middle of the best gap
+     * @param realtimeNs android time (in ns) read within that gap
+     * @param gapNs qtimer time spent reading the android time
+     * @return bool false if no valid pair could be read
+     */
+    bool sampleClocks(uint64_t& qtimerNs, int64_t& realtimeNs, uint64_t& gapNs)
+    {
+        bool valid = false;
+        gapNs = std::numeric_limits<uint64_t>::max();
+        for (int iter = 0; iter < QTIMER_GAP_MAX_ITERATION; iter++) {
+            uint64_t ns = qtimerGetTimeNs();
+            int64_t curr_androidTS = readRealtimeNs();
+            uint64_t ns_end = qtimerGetTimeNs();
+            if (ns > std::numeric_limits<int64_t>::max() || curr_androidTS < 0) {
+                sns_loge("invalid time: ts = %" PRIu64 " curr_androidTS = %" PRId64,
+                    ns, curr_androidTS);
+                continue;
+            }
+            if (ns_end - ns < gapNs) {
+                gapNs = ns_end - ns;
+                qtimerNs = ns + gapNs / 2;
+                realtimeNs = curr_androidTS;
+                valid = true;
+            }
+            if (gapNs <= QTIMER_GAP_THRESHOLD_NS) {
+                break;
+            }
+        }
+        return valid;
+    }
+
+    /**
+     * @brief sample both clocks and add the reading to the mapping
+     *
+     * The new estimate is slewed in over slewPeriodNs, see
+     * qshTimeMapper. Conversions running meanwhile are not blocked,
+     * and if another thread is already updating, this one keeps the
+     * current mapping.
+     * @return bool true if the mapping was updated
+     */
+    bool updateMapping(qshTimeSyncSample& sample, uint64_t slewPeriodNs)
+    {
+        std::unique_lock<std::mutex> lk(mUpdateMutex, std::try_to_lock);
+        if (!lk.owns_lock()) {
+            return false;
+        }
+        if (!sampleClocks(sample.qtimerNs, sample.realtimeNs, sample.gapNs)) {
+            return false;
+        }
+        sample.stepped = mMapper.addSample(sample.qtimerNs, sample.realtimeNs, slewPeriodNs);
+        sample.offsetNs = mMapper.get().offsetNs;
+        sample.rate = mMapper.getRate();
+        sample.residualNs = mMapper.getResidualNs();
+        mOffsetNs = sample.offsetNs;
+        return true;
+    }
+
     /**
      * @brief update offset for qtimer timestamp (in ticks) to android
      *        timestamp (in ns)
+     *
+     * Skipped, unless forced, while the mapping is synchronized by an
+     * external service (see setExternalSync()).
      * @param androidTS realtime timestamp (in ns)
      * @param force if true, recalculate offset even if last update was more
      *        recent than the usual update schedule
@@ -183,71 +457,76 @@ private:
      */
     bool updateQtimerToRealtimeOffset(int64_t androidTS, bool force=false)
     {
-        bool changed = false;
+        if (mExternalSync && !force) {
+            return false;
+        }
         int64_t lastAndroidTS = mLastRealtimeNs;
 
         if (androidTS > 0 &&
             (force ||
             androidTS < lastAndroidTS ||
             androidTS - lastAndroidTS >= OFFSET_UPDATE_SCHEDULE_NS)) {
-            uint64_t ns = 0, ns_end = 0;
-            int iter = 0;
+            qshTimeSyncSample sample;
             int64_t oldmOffsetNs = mOffsetNs;
-            do {
-                ns = qtimerGetTimeNs();
-#ifdef __ANDROID_API__
-                int64_t curr_androidTS = android::elapsedRealtimeNano();
-#else
-                struct timespec _curr_androidTS;
-                clock_gettime(CLOCK_REALTIME, &_curr_androidTS);
-                int64_t curr_androidTS = (int64_t)(_curr_androidTS.tv_sec*NSEC_PER_SEC +_curr_androidTS.tv_nsec);
-#endif
-                if (ns <= std::numeric_limits<int64_t>::max() && curr_androidTS >= 0) {
-                    mOffsetNs = curr_androidTS - int64_t(ns);
-                } else {
-                    sns_loge("invalid time: ts = %" PRIu64 " curr_androidTS = %" PRId64,
-                        ns, curr_androidTS);
-                }
-                ns_end = qtimerGetTimeNs();
-                iter++;
-            } while ((ns_end - ns > QTIMER_GAP_THRESHOLD_NS) &&
-                        (iter < QTIMER_GAP_MAX_ITERATION));
+            if (!updateMapping(sample, OFFSET_UPDATE_SCHEDULE_NS)) {
+                return false;
+            }
             mLastRealtimeNs = androidTS;
             sns_logd("updating qtimer-realtime offset, offset_diff = %" PRId64 \
-                     " time_diff = %" PRId64, mOffsetNs - oldmOffsetNs,
-                     androidTS - lastAndroidTS);
-            changed = true;
+                     " time_diff = %" PRId64 " gap = %" PRIu64 "%s", mOffsetNs - oldmOffsetNs,
+                     androidTS - lastAndroidTS, sample.gapNs, sample.stepped ? " (step)" : "");
+            return true;
         }
-        return changed;
+        return false;
     }
 
-    qshTimeUtil() :
-        mQtimerFreq(qtimerGetFreq())
+    /* the default clock is the wall clock off android */
+    static qshTargetClock resolveTargetClock(qshTargetClock targetClock)
     {
-#ifdef __ANDROID_API__
-        mLastRealtimeNs = android::elapsedRealtimeNano();
-#else
-        struct timespec time_elapsed;
-        clock_gettime(CLOCK_REALTIME, &time_elapsed);
-        mLastRealtimeNs = (int64_t)(time_elapsed.tv_sec*NSEC_PER_SEC+time_elapsed.tv_nsec);
+#ifndef __ANDROID_API__
+        if (qshTargetClock::DEFAULT == targetClock) {
+            return qshTargetClock::REALTIME;
+        }
+#endif
+#ifndef CLOCK_BOOTTIME
+        if (qshTargetClock::BOOTTIME == targetClock) {
+            return qshTargetClock::MONOTONIC;
+        }
 #endif
-        mOffsetNs = mLastRealtimeNs - int64_t(qtimerGetTimeNs());
+        return targetClock;
     }
-    ~qshTimeUtil() = default;
-    /* delete copy constructors/assignment for singleton operation */
-    qshTimeUtil(const qshTimeUtil&) = delete;
-    qshTimeUtil& operator=(const qshTimeUtil&) = delete;
+
+    /* host clock the mapping converts to */
+    const qshTargetClock mTargetClock;
+
+    /* source of the QTimer ticks */
+    const qshClockSource mClock;
 
     /* QTimer frequency in Hz */
     const uint64_t mQtimerFreq;
 
-    /* constant offset between the android elapsedRealTimeNano clock
-       and QTimer clock in nanoseconds */
-    // PEND: Move this variable back into the private section (see PEND below)
-//    const int64_t mOffsetNs;
+    /* offset between the android elapsedRealTimeNano clock and QTimer
+       clock in nanoseconds, as of the last update of the mapping, see
+       getElapsedRealtimeNanoOffset() */
+    std::atomic<std::int64_t> mOffsetNs;
 
     const uint64_t NSEC_PER_SEC = 1000000000ull;
 
+    /* exact QTimer ticks to ns conversion */
+    const qshTickConverter mTicksToNs;
+    /* exact ns to QTimer ticks conversion */
+    const qshTickConverter mNsToTicks;
+
+    /* qtimer to android time mapping, with drift */
+    qshTimeMapper mMapper;
+    /* serializes the updates of mMapper */
+    std::mutex mUpdateMutex;
+    /* mapping kept up to date by an external service */
+    std::atomic<bool> mExternalSync{false};
+
+    /* ticks converted per pass by the batch conversions */
+    static constexpr size_t BATCH_CHUNK = 64;
+
     /* the last realtime timestamp converted or passed */
     std::atomic<std::int64_t> mLastRealtimeNs;
     /* how often offset needs to be updated */
@@ -256,13 +535,108 @@ private:
     const uint64_t QTIMER_GAP_THRESHOLD_NS = 10000;
     /* Max Interation to get minimum offset */
     const int QTIMER_GAP_MAX_ITERATION = 20;
+};
 
+/**
+ * @brief qshTimeUtil converting typed timestamps (see qshTimestamp)
+ *
+ * The target clock is part of the type, so a host timestamp of another
+ * clock does not compile, e.g. a qshMonotonicNs with the default clock
+ * instance.
+ * @tparam Target host clock qtimer timestamps are converted to
+ */
+template<qshTargetClock Target>
+class qshTimeUtilT : public qshTimeUtil
+{
 public:
-    // For some unknown reason, the Android and QTimer timestamps used to
-    // calculate the mOffsetNs only make sense if mOffsetNs is a public
-    // variable. I suspect that our method for reading the QTimer value may
-    // have some unaccounted caveats.
-    // PEND: Make this variable private again once we fix the root-cause for
-    // the invalid QTimer values read during bootup
-    std::atomic<std::int64_t> mOffsetNs;
+    /* host timestamp type of the target clock */
+    using hostTime = qshTimestamp<qshTargetDomain(Target), qshTimeUnit::NS>;
+
+    /**
+     * @brief get the instance of the target clock, the one of
+     *        qshTimeUtil::getInstance() for the default clock
+     */
+    static qshTimeUtilT& getInstance()
+    {
+        static qshTimeUtilT inst;
+        return inst;
+    }
+
+    qshTimeUtilT() : qshTimeUtil(Target) {}
+
+    /**
+     * @brief current QTimer time, as a typed timestamp
+     */
+    qshQtimerTicks qtimerNow()
+    {
+        return qshQtimerTicks(qtimerGetTicks());
+    }
+
+    /**
+     * @brief current time of the target clock, as a typed timestamp
+     */
+    hostTime hostNow() const
+    {
+        return hostTime(readRealtimeNs());
+    }
+
+    /**
+     * @brief convert a typed timestamp to another clock domain or unit
+     *
+     * e.g. convert<qshRealtimeNs>(qshQtimerTicks(event.timestamp)).
+     * Converting to the type the timestamp already has returns it as
+     * is, with no code generated. QTimer to host time conversions go
+     * through the mapping, as qtimerNsToElapsedRealtimeNano() does.
+     * Host domains do not convert into one another.
+     * @tparam To qshQtimerTicks, qshQtimerNs or hostTime
+     */
+    template<typename To, qshClockDomain Domain, qshTimeUnit Unit>
+    To convert(qshTimestamp<Domain, Unit> ts)
+    {
+        return convertTo(ts, static_cast<To*>(nullptr));
+    }
+
+private:
+    /* same domain and unit: nothing to do */
+    template<typename T>
+    static constexpr T convertTo(T ts, T*)
+    {
+        return ts;
+    }
+
+    qshQtimerNs convertTo(qshQtimerTicks ts, qshQtimerNs*)
+    {
+        return qshQtimerNs(qtimerTicksToNs(ts.count()));
+    }
+
+    qshQtimerTicks convertTo(qshQtimerNs ts, qshQtimerTicks*)
+    {
+        return qshQtimerTicks(mNsToTicks.convert(ts.count()));
+    }
+
+    hostTime convertTo(qshQtimerNs ts, hostTime*)
+    {
+        return hostTime(qtimerNsToElapsedRealtimeNano(ts.count()));
+    }
+
+    hostTime convertTo(qshQtimerTicks ts, hostTime*)
+    {
+        return hostTime(qtimerTicksToElapsedRealtimeNano(ts.count()));
+    }
+
+    qshQtimerNs convertTo(hostTime ts, qshQtimerNs*)
+    {
+        return qshQtimerNs(elapsedRealtimeNanoToQtimerNs(ts.count()));
+    }
+
+    qshQtimerTicks convertTo(hostTime ts, qshQtimerTicks*)
+    {
+        return convertTo(qshQtimerNs(elapsedRealtimeNanoToQtimerNs(ts.count())),
+                         static_cast<qshQtimerTicks*>(nullptr));
+    }
 };
+
+inline qshTimeUtil& qshTimeUtil::getInstance()
+{
+    return qshTimeUtilT<qshTargetClock::DEFAULT>::getInstance();
+}
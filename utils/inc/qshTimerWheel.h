@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+/**
+ * type alias for the identifier of a scheduled timer, 0 is never used
+ */
+using qshTimerId = uint64_t;
+static constexpr qshTimerId QSH_INVALID_TIMER = 0;
+
+/**
+ * Hierarchical timer wheel.
+ *
+ * Time is counted in ticks since construction. Timers due within the
+ * next 64 ticks sit in the 64 slots of level 0, timers due later sit
+ * in coarser levels (64x coarser each), and are moved down a level
+ * when their slot comes up. Scheduling and cancelling are O(1), and
+ * a timer is moved at most once per level before it fires.
+ *
+ * Timers live in one pool of nodes chained by index, so scheduling
+ * only allocates when the pool grows. Timer ids carry a generation
+ * count, cancelling a timer which already fired is harmless.
+ *
+ * Not thread-safe, the owner serializes access.
+ */
+template<typename Task>
+class qshTimerWheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief a timer returned by expire()
+     */
+    struct firedTimer {
+        qshTimerId id;
+        Task task;
+        bool periodic;
+    };
+
+    /**
+     * @param tick resolution of the wheel. Timers due within the same
+     *        tick fire together.
+     */
+    explicit qshTimerWheel(std::chrono::nanoseconds tick = std::chrono::milliseconds(1))
+        : mTick(tick.count() > 0 ? tick : std::chrono::nanoseconds(1)),
+          mStart(clock::now())
+    {
+        for (auto& head : mHeads) {
+            head = NIL;
+        }
+    }
+
+    bool empty() const { return 0 == mActive; }
+    size_t size() const { return mActive; }
+
+    /**
+     * @brief schedule a task
+     *
+     * @param due time at which the task is due, a time in the past
+     *        fires on the next expire()
+     * @param task task to fire
+     * @param period if not zero, the timer is re-armed by rearm()
+     *        every period after it fires
+     *
+     * @return id of the timer
+     */
+    qshTimerId schedule(clock::time_point due, Task&& task,
+        std::chrono::nanoseconds period = std::chrono::nanoseconds(0))
+    {
+        uint32_t idx = allocNode();
+        node& n = mNodes[idx];
+        n.task = std::move(task);
+        n.due = toTicks(due);
+        n.period = (period.count() > 0) ? ceilTicks(period) : 0;
+        n.state = PENDING;
+        link(idx);
+        mActive++;
+        return makeId(idx);
+    }
+
+    /**
+     * @brief cancel a timer. A periodic timer being fired is not
+     *        re-armed.
+     *
+     * @return true if the timer was pending or being fired
+     */
+    bool cancel(qshTimerId id)
+    {
+        node* n = lookup(id);
+        if (nullptr == n) {
+            return false;
+        }
+        uint32_t idx = indexOf(id);
+        if (PENDING == n->state) {
+            unlink(idx);
+            freeNode(idx);
+        } else {
+            /* freed when handed back to rearm() */
+            n->state = CANCELLED;
+        }
+        mActive--;
+        return true;
+    }
+
+    /**
+     * @brief move the wheel to the given time and collect the timers
+     *        due by then
+     *
+     * Periodic timers are kept in the FIRING state until their task
+     * is handed back with rearm().
+     *
+     * @return number of timers appended to fired
+     */
+    size_t expire(clock::time_point now, std::vector<firedTimer>& fired)
+    {
+        const size_t before = fired.size();
+        const uint64_t target = floorTicks(now);
+        collect(READY_LIST, fired);
+        while (true) {
+            int list;
+            uint64_t deadline;
+            if (!nextExpiration(list, deadline) || deadline > target) {
+                break;
+            }
+            mNow = deadline;
+            /* timers of a level 0 slot are due, others move down */
+            uint32_t idx = mHeads[list];
+            mHeads[list] = NIL;
+            clearOccupied(list);
+            while (NIL != idx) {
+                uint32_t next = mNodes[idx].next;
+                mNodes[idx].list = NO_LIST;
+                if (mNodes[idx].due <= mNow) {
+                    fire(idx, fired);
+                } else {
+                    link(idx);
+                }
+                idx = next;
+            }
+            collect(READY_LIST, fired);
+        }
+        if (target > mNow) {
+            mNow = target;
+        }
+        return fired.size() - before;
+    }
+
+    /**
+     * @brief hand back the task of a fired periodic timer, the timer
+     *        is scheduled again one period after its previous due
+     *        time (periods already elapsed are skipped)
+     */
+    void rearm(qshTimerId id, Task&& task)
+    {
+        uint32_t idx = indexOf(id);
+        if (idx >= mNodes.size() || mNodes[idx].gen != genOf(id)) {
+            return;
+        }
+        node& n = mNodes[idx];
+        if (CANCELLED == n.state) {
+            freeNode(idx);
+            return;
+        }
+        if (FIRING != n.state) {
+            return;
+        }
+        n.task = std::move(task);
+        n.due += n.period;
+        if (n.due <= mNow) {
+            n.due += ((mNow - n.due) / n.period + 1) * n.period;
+        }
+        n.state = PENDING;
+        link(idx);
+    }
+
+    /**
+     * @brief time at which expire() next has work to do, rounded to
+     *        a tick boundary so that wakeups are coalesced. May be
+     *        earlier than the actual due time of timers in coarse
+     *        levels. time_point::max() if no timer is pending.
+     */
+    clock::time_point nextDeadline() const
+    {
+        if (NIL != mHeads[READY_LIST]) {
+            return fromTicks(mNow);
+        }
+        int list;
+        uint64_t deadline;
+        if (!nextExpiration(list, deadline)) {
+            return clock::time_point::max();
+        }
+        return fromTicks(deadline);
+    }
+
+private:
+    static constexpr int LEVELS = 6;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    /* lists holding timers already due, and timers beyond the top level */
+    static constexpr int READY_LIST = LEVELS * SLOTS;
+    static constexpr int OVERFLOW_LIST = READY_LIST + 1;
+    static constexpr int NUM_LISTS = OVERFLOW_LIST + 1;
+    static constexpr int NO_LIST = -1;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint64_t WHEEL_RANGE = 1ull << (LEVELS * SLOT_BITS);
+
+    enum nodeState : uint8_t { FREE, PENDING, FIRING, CANCELLED };
+
+    struct node {
+        Task task;
+        uint64_t due = 0;
+        uint64_t period = 0;
+        uint32_t gen = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        int list = NO_LIST;
+        nodeState state = FREE;
+    };
+
+    uint64_t floorTicks(clock::time_point tp) const
+    {
+        if (tp <= mStart) {
+            return 0;
+        }
+        return uint64_t((tp - mStart) / mTick);
+    }
+
+    /* due times are rounded up, a timer never fires early */
+    uint64_t toTicks(clock::time_point tp) const
+    {
+        if (tp <= mStart) {
+            return 0;
+        }
+        return ceilTicks(tp - mStart);
+    }
+
+    uint64_t ceilTicks(clock::duration d) const
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d);
+        return uint64_t((ns + mTick - std::chrono::nanoseconds(1)) / mTick);
+    }
+
+    clock::time_point fromTicks(uint64_t ticks) const
+    {
+        return mStart + std::chrono::duration_cast<clock::duration>(mTick * ticks);
+    }
+
+    qshTimerId makeId(uint32_t idx) const
+    {
+        return (uint64_t(mNodes[idx].gen) << 32) | (uint64_t(idx) + 1);
+    }
+    static uint32_t indexOf(qshTimerId id) { return uint32_t(id & UINT32_MAX) - 1; }
+    static uint32_t genOf(qshTimerId id) { return uint32_t(id >> 32); }
+
+    node* lookup(qshTimerId id)
+    {
+        uint32_t idx = indexOf(id);
+        if (QSH_INVALID_TIMER == id || idx >= mNodes.size()) {
+            return nullptr;
+        }
+        node& n = mNodes[idx];
+        if (n.gen != genOf(id) || (PENDING != n.state && FIRING != n.state)) {
+            return nullptr;
+        }
+        return &n;
+    }
+
+    uint32_t allocNode()
+    {
+        if (NIL != mFreeHead) {
+            uint32_t idx = mFreeHead;
+            mFreeHead = mNodes[idx].next;
+            mNodes[idx].next = NIL;
+            return idx;
+        }
+        mNodes.emplace_back();
+        return uint32_t(mNodes.size() - 1);
+    }
+
+    void freeNode(uint32_t idx)
+    {
+        node& n = mNodes[idx];
+        n.task = nullptr;
+        n.state = FREE;
+        n.gen++;
+        n.list = NO_LIST;
+        n.prev = NIL;
+        n.next = mFreeHead;
+        mFreeHead = idx;
+    }
+
+    /* list of a due time, relative to the current tick */
+    int listFor(uint64_t due) const
+    {
+        if (due <= mNow) {
+            return READY_LIST;
+        }
+        /* the level is given by the highest bit differing from now */
+        uint64_t diff = (due ^ mNow) | (SLOTS - 1);
+        int level = (63 - __builtin_clzll(diff)) / SLOT_BITS;
+        if (level >= LEVELS) {
+            return OVERFLOW_LIST;
+        }
+        return level * SLOTS + int((due >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    void link(uint32_t idx)
+    {
+        node& n = mNodes[idx];
+        int list = listFor(n.due);
+        n.list = list;
+        n.prev = NIL;
+        n.next = mHeads[list];
+        if (NIL != n.next) {
+            mNodes[n.next].prev = idx;
+        }
+        mHeads[list] = idx;
+        if (list < READY_LIST) {
+            mOccupied[list / SLOTS] |= (1ull << (list % SLOTS));
+        }
+    }
+
+    void unlink(uint32_t idx)
+    {
+        node& n = mNodes[idx];
+        if (NO_LIST == n.list) {
+            return;
+        }
+        if (NIL != n.prev) {
+            mNodes[n.prev].next = n.next;
+        } else {
+            mHeads[n.list] = n.next;
+        }
+        if (NIL != n.next) {
+            mNodes[n.next].prev = n.prev;
+        }
+        if (NIL == mHeads[n.list]) {
+            clearOccupied(n.list);
+        }
+        n.list = NO_LIST;
+        n.prev = n.next = NIL;
+    }
+
+    void clearOccupied(int list)
+    {
+        if (list < READY_LIST) {
+            mOccupied[list / SLOTS] &= ~(1ull << (list % SLOTS));
+        }
+    }
+
+    void fire(uint32_t idx, std::vector<firedTimer>& fired)
+    {
+        node& n = mNodes[idx];
+        qshTimerId id = makeId(idx);
+        bool periodic = (0 != n.period);
+        fired.push_back(firedTimer{id, std::move(n.task), periodic});
+        if (periodic) {
+            n.state = FIRING;
+            n.list = NO_LIST;
+        } else {
+            freeNode(idx);
+            mActive--;
+        }
+    }
+
+    void collect(int list, std::vector<firedTimer>& fired)
+    {
+        uint32_t idx = mHeads[list];
+        mHeads[list] = NIL;
+        while (NIL != idx) {
+            uint32_t next = mNodes[idx].next;
+            fire(idx, fired);
+            idx = next;
+        }
+    }
+
+    /* first slot whose timers must be fired or moved down */
+    bool nextExpiration(int& list, uint64_t& deadline) const
+    {
+        for (int level = 0; level < LEVELS; level++) {
+            if (0 == mOccupied[level]) {
+                continue;
+            }
+            /* occupied slots of a level always follow the current one */
+            int slot = __builtin_ctzll(mOccupied[level]);
+            int shift = level * SLOT_BITS;
+            uint64_t levelStart = (shift + SLOT_BITS < 64) ?
+                (mNow & ~((1ull << (shift + SLOT_BITS)) - 1)) : 0;
+            list = level * SLOTS + slot;
+            deadline = levelStart + (uint64_t(slot) << shift);
+            return true;
+        }
+        if (NIL != mHeads[OVERFLOW_LIST]) {
+            /* start of the next top level range */
+            list = OVERFLOW_LIST;
+            deadline = (mNow | (WHEEL_RANGE - 1)) + 1;
+            return true;
+        }
+        return false;
+    }
+
+    const std::chrono::nanoseconds mTick;
+    const clock::time_point mStart;
+    uint64_t mNow = 0;
+    size_t mActive = 0;
+    uint32_t mHeads[NUM_LISTS];
+    uint64_t mOccupied[LEVELS] = {};
+    std::vector<node> mNodes;
+    uint32_t mFreeHead = NIL;
+};
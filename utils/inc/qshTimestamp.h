@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief clock a timestamp was taken from
+ */
+enum class qshClockDomain
+{
+    QTIMER,     /* hub and qshTimeUtil tick counter */
+    REALTIME,   /* android elapsedRealtimeNano, qshTargetClock::DEFAULT */
+    BOOTTIME,   /* CLOCK_BOOTTIME, qshTargetClock::BOOTTIME */
+    MONOTONIC,  /* CLOCK_MONOTONIC, qshTargetClock::MONOTONIC */
+    WALLCLOCK,  /* CLOCK_REALTIME, qshTargetClock::REALTIME */
+};
+
+/**
+ * @brief unit a timestamp is counted in
+ */
+enum class qshTimeUnit
+{
+    TICKS,      /* QTimer ticks, see qshTimeUtil::qtimerGetFreq() */
+    NS,
+};
+
+/**
+ * @brief Timestamp tagged with its clock domain and unit
+ *
+ * A zero-cost wrapper around the raw count: timestamps of different
+ * domains or units are different types, so they cannot be compared,
+ * subtracted or passed for one another, and conversions between them
+ * go through qshTimeUtilT::convert(). Converting to the same type is
+ * the identity and compiles away.
+ *
+ * Each host clock qshTimeUtil can convert to is a domain of its own,
+ * so timestamps of instances targeting different clocks cannot be
+ * mixed either. Host time only exists in ns; QTimer time is unsigned
+ * and host time signed, like the raw values used by qshTimeUtil.
+ */
+template<qshClockDomain Domain, qshTimeUnit Unit>
+class qshTimestamp
+{
+    static_assert(!(Domain != qshClockDomain::QTIMER && Unit == qshTimeUnit::TICKS),
+                  "host time is not counted in ticks");
+public:
+    using rep = typename std::conditional<Domain == qshClockDomain::QTIMER,
+                                          uint64_t, int64_t>::type;
+    static constexpr qshClockDomain domain = Domain;
+    static constexpr qshTimeUnit unit = Unit;
+
+    constexpr qshTimestamp() : mValue(0) {}
+    constexpr explicit qshTimestamp(rep value) : mValue(value) {}
+
+    /**
+     * @brief raw count, for APIs taking bare integers
+     */
+    constexpr rep count() const { return mValue; }
+
+    /**
+     * @brief move the timestamp by a count of its unit
+     */
+    constexpr qshTimestamp operator+(int64_t delta) const
+    {
+        return qshTimestamp(rep(mValue + rep(delta)));
+    }
+    constexpr qshTimestamp operator-(int64_t delta) const
+    {
+        return qshTimestamp(rep(mValue - rep(delta)));
+    }
+
+    /**
+     * @brief move a ns timestamp by a duration
+     */
+    template<typename R, typename P, qshTimeUnit U = Unit,
+             typename = typename std::enable_if<U == qshTimeUnit::NS>::type>
+    constexpr qshTimestamp operator+(std::chrono::duration<R, P> delta) const
+    {
+        return *this + int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count());
+    }
+    template<typename R, typename P, qshTimeUnit U = Unit,
+             typename = typename std::enable_if<U == qshTimeUnit::NS>::type>
+    constexpr qshTimestamp operator-(std::chrono::duration<R, P> delta) const
+    {
+        return *this - int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count());
+    }
+
+    /**
+     * @brief signed count of the unit from rhs to this timestamp
+     */
+    constexpr int64_t operator-(qshTimestamp rhs) const { return int64_t(mValue - rhs.mValue); }
+
+    constexpr bool operator==(qshTimestamp rhs) const { return mValue == rhs.mValue; }
+    constexpr bool operator!=(qshTimestamp rhs) const { return mValue != rhs.mValue; }
+    constexpr bool operator<(qshTimestamp rhs) const { return mValue < rhs.mValue; }
+    constexpr bool operator<=(qshTimestamp rhs) const { return mValue <= rhs.mValue; }
+    constexpr bool operator>(qshTimestamp rhs) const { return mValue > rhs.mValue; }
+    constexpr bool operator>=(qshTimestamp rhs) const { return mValue >= rhs.mValue; }
+
+private:
+    rep mValue;
+};
+
+template<qshClockDomain Domain, qshTimeUnit Unit>
+constexpr qshClockDomain qshTimestamp<Domain, Unit>::domain;
+template<qshClockDomain Domain, qshTimeUnit Unit>
+constexpr qshTimeUnit qshTimestamp<Domain, Unit>::unit;
+
+/* QTimer ticks: sns_client_event.timestamp, qtimerGetTicks() */
+using qshQtimerTicks = qshTimestamp<qshClockDomain::QTIMER, qshTimeUnit::TICKS>;
+/* QTimer time in ns: qtimerGetTimeNs() */
+using qshQtimerNs = qshTimestamp<qshClockDomain::QTIMER, qshTimeUnit::NS>;
+/* android time in ns: elapsedRealtimeNano() */
+using qshRealtimeNs = qshTimestamp<qshClockDomain::REALTIME, qshTimeUnit::NS>;
+/* host time in ns of the instances targeting another clock */
+using qshBoottimeNs = qshTimestamp<qshClockDomain::BOOTTIME, qshTimeUnit::NS>;
+using qshMonotonicNs = qshTimestamp<qshClockDomain::MONOTONIC, qshTimeUnit::NS>;
+using qshWallclockNs = qshTimestamp<qshClockDomain::WALLCLOCK, qshTimeUnit::NS>;
+
+static_assert(sizeof(qshQtimerTicks) == sizeof(uint64_t), "timestamps must stay raw sized");
+static_assert(std::is_trivially_copyable<qshRealtimeNs>::value, "timestamps must stay trivial");
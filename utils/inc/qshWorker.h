@@ -7,10 +7,15 @@
 #include <atomic>
 #include <thread>
 #include <atomic>
-#include <queue>
+#include <vector>
 #include <functional>
+#include <chrono>
 #include <memory>
+#include <utility>
+#include <type_traits>
 #include <string.h>
+#include <cstdio>
+#include <cinttypes>
 #include <mutex>
 #include <condition_variable>
 #ifdef USE_GLIB
@@ -18,10 +23,16 @@
 #define strlcpy g_strlcpy
 #endif
 #include "qshLog.h"
+#include "qshInplaceFunction.h"
+#include "qshTimerWheel.h"
+#include "qshThreadAttr.h"
 #ifndef _WIN32
 #include <pthread.h>
 #endif
 #include <condition_variable>
+#ifdef QSH_WORKER_TRACE
+#include "qshTrace.h"
+#endif
 
 #define UNUSED(x) (void)(x)
 /**
@@ -29,11 +40,243 @@
  */
 using workerTask = std::function<void()>;
 
+/**
+ * inline capture size of worker tasks, in bytes. Closures up to this
+ * size are queued without any heap allocation, larger ones are boxed.
+ * Part of the layout of qshWorker, so fixed for the library and all
+ * its clients.
+ */
+static constexpr size_t QSH_WORKER_TASK_CAPACITY = 64;
+
+/**
+ * type alias for the non-allocating task type queued by workers
+ */
+using workerInplaceTask = qshInplaceFunction<void(), QSH_WORKER_TASK_CAPACITY>;
+
+inline workerInplaceTask makeWorkerTask(workerInplaceTask&& task)
+{
+    return std::move(task);
+}
+
+/**
+ * @brief wrap a callable into a worker task, in place when it fits
+ *        QSH_WORKER_TASK_CAPACITY
+ */
+template<typename F, typename Fn = typename std::decay<F>::type>
+typename std::enable_if<workerInplaceTask::fits<Fn>(), workerInplaceTask>::type
+makeWorkerTask(F&& task)
+{
+    return workerInplaceTask(std::forward<F>(task));
+}
+
+/**
+ * @brief wrap a callable into a worker task, boxed on the heap as it
+ *        is too large, over-aligned or may throw when moved
+ */
+template<typename F, typename Fn = typename std::decay<F>::type>
+typename std::enable_if<!workerInplaceTask::fits<Fn>(), workerInplaceTask>::type
+makeWorkerTask(F&& task)
+{
+    std::unique_ptr<Fn> boxed(new Fn(std::forward<F>(task)));
+    return workerInplaceTask([boxed = std::move(boxed)]() { (*boxed)(); });
+}
+
+/**
+ * type alias for the timer wheel scheduling delayed worker tasks
+ */
+using workerTimerWheel = qshTimerWheel<workerInplaceTask>;
+
+/**
+ * Growable FIFO ring.
+ *
+ * Storage is only reallocated when the ring grows, so once the worker
+ * has seen its peak backlog, queueing a task does not allocate.
+ */
+template<typename T>
+class qshRing
+{
+public:
+    bool empty() const { return 0 == mCount; }
+    size_t size() const { return mCount; }
+
+    void push(T&& item)
+    {
+        if (mCount == mSlots.size()) {
+            grow();
+        }
+        mSlots[(mHead + mCount) & (mSlots.size() - 1)] = std::move(item);
+        mCount++;
+    }
+
+    T& front() { return mSlots[mHead]; }
+
+    /* idx-th item from the front */
+    T& at(size_t idx) { return mSlots[(mHead + idx) & (mSlots.size() - 1)]; }
+
+    void swap(qshRing& other)
+    {
+        mSlots.swap(other.mSlots);
+        std::swap(mHead, other.mHead);
+        std::swap(mCount, other.mCount);
+    }
+
+    T pop()
+    {
+        T item = std::move(mSlots[mHead]);
+        mHead = (mHead + 1) & (mSlots.size() - 1);
+        mCount--;
+        return item;
+    }
+
+    void clear()
+    {
+        while (!empty()) {
+            pop();
+        }
+    }
+
+private:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    void grow()
+    {
+        std::vector<T> slots(mSlots.empty() ? MIN_CAPACITY : mSlots.size() * 2);
+        for (size_t idx = 0; idx < mCount; idx++) {
+            slots[idx] = std::move(mSlots[(mHead + idx) & (mSlots.size() - 1)]);
+        }
+        mSlots.swap(slots);
+        mHead = 0;
+    }
+
+    std::vector<T> mSlots;
+    size_t mHead = 0;
+    size_t mCount = 0;
+};
+
+/**
+ * type alias for a FIFO ring of worker tasks
+ */
+using qshTaskRing = qshRing<workerInplaceTask>;
+
+/**
+ * Order in which a multi-lane worker serves its lanes
+ */
+enum class workerLanePolicy
+{
+    /* always serve the highest priority non-empty lane (lane 0 first) */
+    STRICT,
+    /* serve up to weight tasks of each lane per round, in priority
+       order, so that low priority lanes are never starved */
+    WEIGHTED,
+};
+
+/**
+ * What a worker does with a task whose deadline has passed when it is
+ * dequeued
+ */
+enum class workerExpiredPolicy
+{
+    DROP,   /* discard the task, it is counted as dropped */
+    FLAG,   /* run the task anyway, it is counted as expired */
+};
+
+/**
+ * Options of a task added to a multi-lane worker
+ */
+struct workerTaskOptions
+{
+    /* lane to queue the task in, 0 is the highest priority */
+    size_t lane = 0;
+    /* time by which the task must have started */
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    workerExpiredPolicy expiredPolicy = workerExpiredPolicy::DROP;
+};
+
+/**
+ * number of buckets of the worker time histograms. Bucket 0 counts
+ * durations below 1us, bucket n durations in [2^(n-1), 2^n) us, the
+ * last bucket everything longer.
+ */
+#define QSH_WORKER_HISTOGRAM_BUCKETS 32
+
+/**
+ * Snapshot of the counters of a worker
+ */
+struct workerStats
+{
+    uint64_t enqueued = 0;          /* tasks added */
+    uint64_t dequeued = 0;          /* tasks taken off the queue */
+    uint64_t executed = 0;          /* tasks and timers run */
+    uint64_t timersFired = 0;       /* delayed/periodic runs */
+    uint64_t expiredDropped = 0;    /* tasks dropped past their deadline */
+    uint64_t exceptions = 0;        /* exceptions caught from tasks */
+    uint64_t droppedAtShutdown = 0; /* tasks still queued at shutdown */
+    size_t depth = 0;               /* tasks currently queued */
+    size_t maxDepth = 0;            /* highest depth seen */
+    size_t activeTimers = 0;        /* delayed/periodic tasks pending */
+    /* time spent queued, and running, log2 microsecond buckets */
+    uint64_t waitUs[QSH_WORKER_HISTOGRAM_BUCKETS] = {};
+    uint64_t execUs[QSH_WORKER_HISTOGRAM_BUCKETS] = {};
+
+    /**
+     * @brief upper bound of the histogram bucket holding the given
+     *        percentile, in microseconds
+     *
+     * @param histogram waitUs or execUs
+     * @param percentile 0 to 100
+     */
+    static uint64_t percentileUs(const uint64_t* histogram, double percentile)
+    {
+        uint64_t total = 0;
+        for (int idx = 0; idx < QSH_WORKER_HISTOGRAM_BUCKETS; idx++) {
+            total += histogram[idx];
+        }
+        if (0 == total) {
+            return 0;
+        }
+        uint64_t rank = uint64_t(double(total) * percentile / 100.0);
+        uint64_t seen = 0;
+        for (int idx = 0; idx < QSH_WORKER_HISTOGRAM_BUCKETS; idx++) {
+            seen += histogram[idx];
+            if (seen > rank) {
+                return 1ull << idx;
+            }
+        }
+        return 1ull << (QSH_WORKER_HISTOGRAM_BUCKETS - 1);
+    }
+};
+
+/**
+ * Per-lane counters of a worker
+ */
+struct workerLaneStats
+{
+    size_t depth = 0;           /* tasks currently queued */
+    size_t maxDepth = 0;        /* highest depth seen */
+    uint64_t enqueued = 0;      /* tasks added */
+    uint64_t executed = 0;      /* tasks run, including expired ones */
+    uint64_t expiredDropped = 0;/* tasks dropped past their deadline */
+    uint64_t expiredRun = 0;    /* tasks run past their deadline */
+};
+
 /**
  * Implementation of a worker thread with its own task-queue.
  * Worker thread starts running when constructed and stops when
  * destroyed. Tasks can be assigned to the worker
  * asynchronously and they will be performed in order.
+ *
+ * Delayed and periodic tasks are kept in a timer wheel served by the
+ * same thread, so any number of timers costs no extra thread. Timers
+ * due within the same wheel tick run on a single wakeup.
+ *
+ * A worker can be created with several priority lanes. Tasks are FIFO
+ * within a lane, and lanes are served according to a
+ * workerLanePolicy. Tasks may carry a deadline, checked when the task
+ * is dequeued.
+ *
+ * In batch mode (see setBatchMode()), the worker takes all pending
+ * tasks in one critical section and runs them without touching the
+ * lock, which makes bursts of small tasks much cheaper.
  */
 class qshWorker
 {
@@ -41,8 +284,26 @@ public:
     /**
      * @brief creates a worker thread and starts processing tasks
      */
-    qshWorker(): mAlive(true)
+    qshWorker(): qshWorker(1) {}
+
+    /**
+     * @brief creates a multi-lane worker thread and starts processing
+     *        tasks
+     *
+     * @param numLanes number of priority lanes, at least 1
+     * @param policy how lanes are served
+     * @param weights tasks served per round for each lane with the
+     *        WEIGHTED policy, 1 for lanes not listed
+     */
+    explicit qshWorker(size_t numLanes, workerLanePolicy policy = workerLanePolicy::STRICT,
+        std::vector<unsigned> weights = {}) :
+        mAlive(true), mPolicy(policy), mLanes(numLanes > 0 ? numLanes : 1)
     {
+        for (size_t idx = 0; idx < mLanes.size(); idx++) {
+            unsigned weight = (idx < weights.size()) ? weights[idx] : 1;
+            mLanes[idx].weight = (weight > 0) ? weight : 1;
+            mLanes[idx].credits = mLanes[idx].weight;
+        }
         mThread = std::thread([this] { run(); });
     }
 
@@ -71,13 +332,86 @@ public:
         mConditionVar.notify_one();
         lk.unlock();
         mThread.join();
-        size_t num_of_task = mTaskQueue.size();
+        size_t num_of_task = pendingTasks();
+        lk.lock();
+        /* tasks of an interrupted batch have been counted already */
+        mStats.droppedAtShutdown += num_of_task;
+        if (0 != mStats.droppedAtShutdown) {
+            sns_logi("worker %s: %" PRIu64 " task(s) dropped at shutdown", mName,
+                     mStats.droppedAtShutdown);
+        }
     }
 
     void setName(const char *name) {
 #ifndef _WIN32
         pthread_setname_np(mThread.native_handle() , name);
 #endif
+        std::lock_guard<std::mutex> lk(mMutex);
+        snprintf(mName, sizeof(mName), "%s", name);
+    }
+
+    /**
+     * @brief apply scheduling attributes (affinity, policy, priority,
+     *        stack locking) to the worker thread
+     *
+     * @return QSH_THREAD_ATTR_OK, or the QSH_THREAD_ATTR_* bits of
+     *         the attributes which could not be applied
+     */
+    int setThreadAttr(const qshThreadAttr& attr)
+    {
+#ifndef _WIN32
+        char name[sizeof(mName)];
+        {
+            std::lock_guard<std::mutex> lk(mMutex);
+            memcpy(name, mName, sizeof(name));
+        }
+        return qshApplyThreadAttr(mThread.native_handle(), attr, name);
+#else
+        return QSH_THREAD_ATTR_UNSUPPORTED;
+#endif
+    }
+
+    /**
+     * @brief get a snapshot of the worker counters
+     */
+    workerStats getStats()
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        workerStats stats = mStats;
+        stats.depth = pendingTasks();
+        stats.activeTimers = mTimers.size();
+        return stats;
+    }
+
+    /**
+     * @brief write the worker counters to the log
+     */
+    void logStats()
+    {
+        workerStats stats = getStats();
+        sns_logi("worker %s: enqueued=%" PRIu64 " dequeued=%" PRIu64 " executed=%" PRIu64
+                 " timers=%" PRIu64 " expired=%" PRIu64 " exceptions=%" PRIu64
+                 " depth=%zu max_depth=%zu", mName, stats.enqueued, stats.dequeued,
+                 stats.executed, stats.timersFired, stats.expiredDropped,
+                 stats.exceptions, stats.depth, stats.maxDepth);
+        if (mTimeStats.load(std::memory_order_relaxed)) {
+            sns_logi("worker %s: wait p50<=%" PRIu64 "us p99<=%" PRIu64 "us,"
+                     " exec p50<=%" PRIu64 "us p99<=%" PRIu64 "us", mName,
+                     workerStats::percentileUs(stats.waitUs, 50),
+                     workerStats::percentileUs(stats.waitUs, 99),
+                     workerStats::percentileUs(stats.execUs, 50),
+                     workerStats::percentileUs(stats.execUs, 99));
+        }
+    }
+
+    /**
+     * @brief enable or disable the timing statistics, i.e. the wait
+     *        and run time histograms, which read the clock around
+     *        each task. Enabled by default, counters are always kept.
+     */
+    void setTimeStats(bool enable)
+    {
+        mTimeStats.store(enable, std::memory_order_relaxed);
     }
 
      /**
@@ -88,52 +422,557 @@ public:
      * @param task task to perform
      */
     void addTask(const workerTask& task)
+    {
+        if (nullptr == task) {
+            return;
+        }
+        addTask(workerInplaceTask(task));
+    }
+
+    /**
+     * @brief add a new task for the worker to do, without copying
+     *        or allocating
+     *
+     * The callable is stored inline when it fits in
+     * QSH_WORKER_TASK_CAPACITY bytes, and is boxed on the heap
+     * otherwise.
+     *
+     * @param task callable to perform
+     */
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerInplaceTask>::value &&
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    void addTask(F&& task)
+    {
+        addTask(makeWorkerTask(std::forward<F>(task)));
+    }
+
+    void addTask(workerInplaceTask&& task)
+    {
+        addTask(workerTaskOptions(), std::move(task));
+    }
+
+    /**
+     * @brief add a new task to a lane of the worker, optionally with
+     *        a deadline
+     *
+     * @param options lane and deadline of the task
+     * @param task task to perform
+     */
+    void addTask(const workerTaskOptions& options, const workerTask& task)
+    {
+        if (nullptr == task) {
+            return;
+        }
+        addTask(options, workerInplaceTask(task));
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerInplaceTask>::value &&
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    void addTask(const workerTaskOptions& options, F&& task)
+    {
+        addTask(options, makeWorkerTask(std::forward<F>(task)));
+    }
+
+    void addTask(const workerTaskOptions& options, workerInplaceTask&& task)
     {
         std::lock_guard<std::mutex> lk(mMutex);
         //no task should be enqueued if shutdown has already begun
         if(!mAlive)
             return;
 
+        if (enqueue(options, std::move(task), statsNow())) {
+            mConditionVar.notify_one();
+        }
+    }
+
+    /**
+     * @brief add several tasks at once, with a single lock and a
+     *        single wakeup of the worker
+     *
+     * Tasks are performed in the order of the vector. The vector is
+     * left empty.
+     *
+     * @param tasks tasks to perform
+     * @param options lane and deadline of all the tasks
+     */
+    void addTasks(std::vector<workerInplaceTask>& tasks,
+        const workerTaskOptions& options = workerTaskOptions())
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        if(!mAlive) {
+            tasks.clear();
+            return;
+        }
+        auto now = statsNow();
+        bool queued = false;
+        for (auto& task : tasks) {
+            if (nullptr != task) {
+                queued = enqueue(options, std::move(task), now) || queued;
+            }
+        }
+        tasks.clear();
+        if (queued) {
+            mConditionVar.notify_one();
+        }
+    }
+
+    void addTasks(const std::vector<workerTask>& tasks,
+        const workerTaskOptions& options = workerTaskOptions())
+    {
+        std::vector<workerInplaceTask> inplaceTasks;
+        inplaceTasks.reserve(tasks.size());
+        for (const auto& task : tasks) {
+            if (nullptr != task) {
+                inplaceTasks.emplace_back(task);
+            }
+        }
+        addTasks(inplaceTasks, options);
+    }
+
+    /**
+     * @brief enable or disable batch mode
+     *
+     * In batch mode the worker takes up to maxBatch pending tasks per
+     * lock acquisition. With several lanes, tasks are still taken in
+     * lane order, but a high priority task added while a batch runs
+     * waits for the end of the batch: keep maxBatch small on
+     * latency-sensitive multi-lane workers.
+     *
+     * @param maxBatch maximum number of tasks per batch, 0 to disable
+     */
+    void setBatchMode(size_t maxBatch)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        mBatchSize = maxBatch;
+    }
+
+    /**
+     * @brief get the counters of a lane
+     */
+    workerLaneStats getLaneStats(size_t laneIdx)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        if (laneIdx >= mLanes.size()) {
+            return workerLaneStats();
+        }
+        workerLaneStats stats = mLanes[laneIdx].stats;
+        stats.depth = mLanes[laneIdx].tasks.size();
+        return stats;
+    }
+
+    size_t getNumLanes() const { return mLanes.size(); }
+
+    /**
+     * @brief run a task once, after a delay
+     *
+     * @param delay time to wait before running the task
+     * @param task task to perform
+     *
+     * @return id of the timer for cancelTimer(), QSH_INVALID_TIMER
+     *         if the worker is shutting down
+     */
+    qshTimerId addDelayedTask(std::chrono::nanoseconds delay, const workerTask& task)
+    {
+        if (nullptr == task) {
+            return QSH_INVALID_TIMER;
+        }
+        return addTimer(delay, std::chrono::nanoseconds(0), workerInplaceTask(task));
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    qshTimerId addDelayedTask(std::chrono::nanoseconds delay, F&& task)
+    {
+        return addTimer(delay, std::chrono::nanoseconds(0), makeWorkerTask(std::forward<F>(task)));
+    }
+
+    /**
+     * @brief run a task every period, starting one period from now
+     *
+     * Runs are aligned on the initial schedule: a run delayed by a
+     * long task does not shift the following ones, and periods missed
+     * entirely are skipped.
+     *
+     * @param period time between two runs, must not be zero
+     * @param task task to perform
+     *
+     * @return id of the timer for cancelTimer(), QSH_INVALID_TIMER
+     *         if the worker is shutting down or period is zero
+     */
+    qshTimerId addPeriodicTask(std::chrono::nanoseconds period, const workerTask& task)
+    {
+        if (nullptr == task) {
+            return QSH_INVALID_TIMER;
+        }
+        return addPeriodicTask(period, workerInplaceTask(task));
+    }
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, workerTask>::value>::type>
+    qshTimerId addPeriodicTask(std::chrono::nanoseconds period, F&& task)
+    {
+        if (period.count() <= 0) {
+            sns_loge("invalid period for periodic task");
+            return QSH_INVALID_TIMER;
+        }
+        return addTimer(period, period, makeWorkerTask(std::forward<F>(task)));
+    }
+
+    /**
+     * @brief cancel a delayed or periodic task. A run already in
+     *        progress completes, but is not repeated.
+     *
+     * @return true if the timer was still active
+     */
+    bool cancelTimer(qshTimerId id)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        return mTimers.cancel(id);
+    }
+
+private:
+
+    struct laneTask {
+        workerInplaceTask task;
+        std::chrono::steady_clock::time_point deadline;
+        workerExpiredPolicy expiredPolicy = workerExpiredPolicy::DROP;
+        std::chrono::steady_clock::time_point enqueueTime;
+        size_t lane = 0;
+    };
+
+    struct lane {
+        qshRing<laneTask> tasks;
+        unsigned weight = 1;
+        unsigned credits = 1;
+        workerLaneStats stats;
+    };
+
+    size_t pendingTasks() const
+    {
+        size_t count = 0;
+        for (const auto& l : mLanes) {
+            count += l.tasks.size();
+        }
+        return count;
+    }
+
+    /* index of the lane to serve next, -1 if all lanes are empty */
+    int pickLane()
+    {
+        if (workerLanePolicy::STRICT == mPolicy) {
+            for (size_t idx = 0; idx < mLanes.size(); idx++) {
+                if (!mLanes[idx].tasks.empty()) {
+                    return int(idx);
+                }
+            }
+            return -1;
+        }
+        for (int round = 0; round < 2; round++) {
+            bool pending = false;
+            for (size_t idx = 0; idx < mLanes.size(); idx++) {
+                lane& l = mLanes[idx];
+                if (l.tasks.empty()) {
+                    continue;
+                }
+                pending = true;
+                if (l.credits > 0) {
+                    l.credits--;
+                    return int(idx);
+                }
+            }
+            if (!pending) {
+                return -1;
+            }
+            /* every non-empty lane used its share, start a new round */
+            for (auto& l : mLanes) {
+                l.credits = l.weight;
+            }
+        }
+        return -1;
+    }
+
+    /* queue a task, with the lock held */
+    bool enqueue(const workerTaskOptions& options, workerInplaceTask&& task,
+        std::chrono::steady_clock::time_point now)
+    {
+        if (options.lane >= mLanes.size()) {
+            sns_loge("invalid lane %zu, worker has %zu lane(s)", options.lane, mLanes.size());
+            return false;
+        }
+        lane& target = mLanes[options.lane];
         try {
-            mTaskQueue.push(task);
+            target.tasks.push(laneTask{std::move(task), options.deadline,
+                                       options.expiredPolicy, now, options.lane});
         } catch (std::exception& e) {
             sns_loge("failed to add new task, %s", e.what());
+            return false;
+        }
+        target.stats.enqueued++;
+        if (target.tasks.size() > target.stats.maxDepth) {
+            target.stats.maxDepth = target.tasks.size();
+        }
+        mStats.enqueued++;
+        mDepth++;
+        if (mDepth > mStats.maxDepth) {
+            mStats.maxDepth = mDepth;
+        }
+#ifdef QSH_WORKER_TRACE
+        QSH_TRACE_INT64(mName, int64_t(mDepth));
+#endif
+        return true;
+    }
+
+    /* account for a dequeued task, with the lock held. Returns false
+       if the task expired and must be dropped */
+    bool accountDequeue(laneTask& entry, std::chrono::steady_clock::time_point& now,
+        bool& nowValid)
+    {
+        lane& l = mLanes[entry.lane];
+        mStats.dequeued++;
+        mDepth--;
+        if (entry.deadline != std::chrono::steady_clock::time_point::max()) {
+            if (!nowValid) {
+                now = std::chrono::steady_clock::now();
+                nowValid = true;
+            }
+            if (now > entry.deadline) {
+                if (workerExpiredPolicy::DROP == entry.expiredPolicy) {
+                    l.stats.expiredDropped++;
+                    mStats.expiredDropped++;
+                    sns_logd("lane %zu: dropped task past its deadline", entry.lane);
+                    return false;
+                }
+                l.stats.expiredRun++;
+                sns_logd("lane %zu: running task past its deadline", entry.lane);
+            }
+        }
+        l.stats.executed++;
+        recordTime(mStats.waitUs, entry.enqueueTime, now);
+        return true;
+    }
+
+    /* dequeue the next task to run, dropping the expired ones */
+    bool nextTask(workerInplaceTask& task)
+    {
+        std::chrono::steady_clock::time_point now = statsNow();
+        bool nowValid = (std::chrono::steady_clock::time_point() != now);
+        int idx;
+        while ((idx = pickLane()) >= 0) {
+            laneTask next = mLanes[idx].tasks.pop();
+            if (!accountDequeue(next, now, nowValid)) {
+                continue;
+            }
+            task = std::move(next.task);
+            return true;
+        }
+        return false;
+    }
+
+    /* take up to mBatchSize tasks, with the lock held. Expired tasks
+       are left in the batch as empty tasks */
+    bool takeBatch(qshRing<laneTask>& batch)
+    {
+        if (1 == mLanes.size() && mLanes[0].tasks.size() <= mBatchSize) {
+            /* swap the whole queue out, the batch ring handed back is
+               empty and keeps its storage */
+            batch.swap(mLanes[0].tasks);
+        } else {
+            int idx;
+            while (batch.size() < mBatchSize && (idx = pickLane()) >= 0) {
+                batch.push(mLanes[idx].tasks.pop());
+            }
+        }
+        std::chrono::steady_clock::time_point now = statsNow();
+        bool nowValid = (std::chrono::steady_clock::time_point() != now);
+        for (size_t idx = 0; idx < batch.size(); idx++) {
+            if (!accountDequeue(batch.at(idx), now, nowValid)) {
+                batch.at(idx).task = nullptr;
+            }
+        }
+        return !batch.empty();
+    }
+
+    /* time for the timing statistics, the epoch when they are off */
+    std::chrono::steady_clock::time_point statsNow() const
+    {
+        if (!mTimeStats.load(std::memory_order_relaxed)) {
+            return std::chrono::steady_clock::time_point();
+        }
+        return std::chrono::steady_clock::now();
+    }
+
+    static void recordTime(uint64_t* histogram, std::chrono::steady_clock::time_point from,
+        std::chrono::steady_clock::time_point to)
+    {
+        if (std::chrono::steady_clock::time_point() == from ||
+            std::chrono::steady_clock::time_point() == to) {
+            /* timing statistics were off at either end */
             return;
         }
-        mConditionVar.notify_one();
+        uint64_t us = (to > from) ?
+            uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count()) : 0;
+        int bucket = 0;
+        while (0 != us && bucket < QSH_WORKER_HISTOGRAM_BUCKETS - 1) {
+            us >>= 1;
+            bucket++;
+        }
+        histogram[bucket]++;
     }
 
-private:
+    qshTimerId addTimer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period,
+        workerInplaceTask&& task)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        if(!mAlive)
+            return QSH_INVALID_TIMER;
+
+        auto due = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+        /* only wake the worker if it sleeps past the new timer */
+        bool earlier = due < mTimers.nextDeadline();
+        qshTimerId id;
+        try {
+            id = mTimers.schedule(due, std::move(task), period);
+        } catch (std::exception& e) {
+            sns_loge("failed to add new timer, %s", e.what());
+            return QSH_INVALID_TIMER;
+        }
+        if (earlier) {
+            mConditionVar.notify_one();
+        }
+        return id;
+    }
+
+    /* runs a task, returns false if it threw */
+    bool runTask(workerInplaceTask& task)
+    {
+#ifdef QSH_WORKER_TRACE
+        QSH_TRACE_BEGIN(mName);
+#endif
+        bool ok = true;
+        try {
+            if(nullptr != task) {
+                task();
+            }
+        } catch (const std::exception& e) {
+            /* if an unhandled exception happened when running
+               the task, just log it and move on */
+            sns_loge("task failed, %s", e.what());
+            ok = false;
+        }
+#ifdef QSH_WORKER_TRACE
+        QSH_TRACE_END();
+#endif
+        return ok;
+    }
 
     /* worker thread's mainloop */
     void run()
     {
+        std::vector<workerTimerWheel::firedTimer> fired;
+        qshRing<laneTask> batch;
+        std::unique_lock<std::mutex> lk(mMutex);
         while (mAlive) {
-            std::unique_lock<std::mutex> lk(mMutex);
-            while (mTaskQueue.empty() && mAlive) {
-                mConditionVar.wait(lk);
+            if (!mTimers.empty()) {
+                mTimers.expire(std::chrono::steady_clock::now(), fired);
             }
-            if (mAlive && !mTaskQueue.empty()) {
-                auto task = std::move(mTaskQueue.front());
-                mTaskQueue.pop();
+            if (!fired.empty()) {
+                uint64_t failed = 0;
+                size_t ran = 0;
+                auto start = statsNow();
                 lk.unlock();
-                try {
-                    if(nullptr != task) {
-                        task();
+                for (auto& timer : fired) {
+                    if (!mAlive) {
+                        break;
                     }
-                } catch (const std::exception& e) {
-                    /* if an unhandled exception happened when running
-                       the task, just log it and move on */
-                    sns_loge("task failed, %s", e.what());
+                    failed += runTask(timer.task) ? 0 : 1;
+                    ran++;
                 }
+                auto end = statsNow();
                 lk.lock();
+                mStats.executed += ran;
+                mStats.timersFired += ran;
+                mStats.exceptions += failed;
+                if (0 != ran && std::chrono::steady_clock::time_point() != end) {
+                    /* timers of one tick run back to back, account
+                       for the mean run time of the batch */
+                    recordTime(mStats.execUs, start, start + (end - start) / ran);
+                }
+                for (auto& timer : fired) {
+                    if (timer.periodic) {
+                        mTimers.rearm(timer.id, std::move(timer.task));
+                    }
+                }
+                fired.clear();
+                continue;
+            }
+            if (0 != mBatchSize && takeBatch(batch)) {
+                uint64_t execUs[QSH_WORKER_HISTOGRAM_BUCKETS] = {};
+                uint64_t ran = 0;
+                uint64_t failed = 0;
+                size_t dropped = 0;
+                lk.unlock();
+                while (!batch.empty()) {
+                    laneTask entry = batch.pop();
+                    if (!mAlive) {
+                        dropped += (nullptr != entry.task) ? 1 : 0;
+                        continue;
+                    }
+                    if (nullptr == entry.task) {
+                        continue;
+                    }
+                    auto start = statsNow();
+                    failed += runTask(entry.task) ? 0 : 1;
+                    entry.task = nullptr;
+                    recordTime(execUs, start, statsNow());
+                    ran++;
+                }
+                lk.lock();
+                mStats.executed += ran;
+                mStats.exceptions += failed;
+                mStats.droppedAtShutdown += dropped;
+                for (int idx = 0; idx < QSH_WORKER_HISTOGRAM_BUCKETS; idx++) {
+                    mStats.execUs[idx] += execUs[idx];
+                }
+                continue;
+            }
+            workerInplaceTask task;
+            if (nextTask(task)) {
+                auto start = statsNow();
+                lk.unlock();
+                bool ok = runTask(task);
+                task = nullptr;
+                auto end = statsNow();
+                lk.lock();
+                mStats.executed++;
+                mStats.exceptions += ok ? 0 : 1;
+                recordTime(mStats.execUs, start, end);
+                continue;
+            }
+            auto deadline = mTimers.nextDeadline();
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                mConditionVar.wait(lk);
+            } else {
+                mConditionVar.wait_until(lk, deadline);
             }
-            lk.unlock();
         }
     }
 
     std::atomic<bool> mAlive;
-    std::queue<workerTask> mTaskQueue;
+    const workerLanePolicy mPolicy;
+    std::vector<lane> mLanes;
+    size_t mDepth = 0;
+    size_t mBatchSize = 0;
+    workerStats mStats;
+    std::atomic<bool> mTimeStats{true};
+    char mName[16] = "worker";
+    workerTimerWheel mTimers;
     std::mutex mMutex;
     std::condition_variable mConditionVar;
     std::thread mThread;
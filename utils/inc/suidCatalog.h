@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "suidLookUp.h"
+
+/**
+ * @brief Change to the list of suids advertising a datatype
+ */
+struct suidDelta
+{
+    std::string datatype;       /* datatype whose suid list changed */
+    std::vector<suid> added;    /* suids which became available */
+    std::vector<suid> removed;  /* suids which are no longer available */
+};
+
+/**
+ * @brief type alias for a catalog subscriber
+ *
+ * param delta: change applied to the catalog
+ */
+using suidDeltaCb = std::function<void(const suidDelta& delta)>;
+
+/**
+ * @brief Long-lived, incrementally updated sensor catalog
+ *
+ * suidCatalog keeps a single suidLookUp session open for its whole
+ * lifetime. Every tracked datatype is requested once with
+ * register_updates set, and each sns_suid_event received afterwards
+ * is applied to the in-memory catalog as a delta. Sensors that show
+ * up late (dynamic or hot-plugged sensors) are therefore seen without
+ * opening a new lookup session.
+ *
+ * Subscribers are notified with the delta of every change. The
+ * notification is sent from the session's event thread and must not
+ * block.
+ *
+ * Once the hub has reported discovery done, datatypes it did not
+ * report are remembered as absent, so repeated lookups for sensors
+ * missing on this SKU fail immediately instead of timing out. An
+ * absent datatype becomes present again if the hub later publishes it.
+ */
+class suidCatalog
+{
+public:
+    /**
+     * @brief opens the lookup session used by this catalog
+     *
+     * @param hubId sensor hub ID to query. Use -1 for default hub
+     */
+    suidCatalog(int hubId = -1);
+    ~suidCatalog();
+
+    /**
+     * @brief get the catalog shared by the whole process for a hub
+     *
+     * The shared catalog, and its lookup session, stay alive until
+     * the process exits so that its content (including absent
+     * datatypes) is reused by every lookup.
+     *
+     * @param hubId sensor hub ID. Use -1 for default hub
+     */
+    static std::shared_ptr<suidCatalog> getShared(int hubId = -1);
+
+    /**
+     * @brief start tracking a datatype. The first call for a
+     *        datatype sends the suid request, later calls are no-ops.
+     *
+     * Default-only requests are sent on a separate session and kept
+     * apart from the full suid lists: they only serve lookUpDefault(),
+     * and are neither reported by getSuids() nor to subscribers.
+     *
+     * @param datatype datatype to track (e.g., "accel")
+     * @param defaultOnly track only the default suid of the datatype
+     *
+     * @return false if the request could not be sent, the datatype is
+     *         then not tracked
+     */
+    bool track(const std::string& datatype, bool defaultOnly = false);
+
+    /**
+     * @brief get the default suid of a datatype
+     *
+     * Served from the catalog without any hub round trip if the
+     * default suid is already known, or the datatype known to be
+     * absent. Otherwise a default-only request is sent and the call
+     * waits for the answer.
+     *
+     * @param datatype datatype to look up
+     * @param sensorUid filled with the default suid on success
+     * @param timeoutMs maximum time to wait on catalog miss
+     *
+     * @return true if a default suid is available, false if the
+     *         datatype is absent or the lookup timed out
+     */
+    bool lookUpDefault(const std::string& datatype, suid& sensorUid,
+        std::chrono::milliseconds timeoutMs);
+
+    /**
+     * @brief check whether a datatype is known to be absent on the hub
+     */
+    bool isAbsent(const std::string& datatype);
+
+    /**
+     * @brief get the suids currently known for a datatype
+     *
+     * @param datatype datatype to query
+     * @param suids filled with the known suids
+     *
+     * @return true if the hub has reported the suid list for this
+     *         datatype at least once, false otherwise
+     */
+    bool getSuids(const std::string& datatype, std::vector<suid>& suids);
+
+    /**
+     * @brief get all datatypes reported by the hub so far
+     */
+    std::vector<std::string> getDataTypes();
+
+    /**
+     * @brief wait until the suid list of a datatype has been reported
+     *
+     * Returns early if the datatype is, or turns out to be, absent.
+     *
+     * @param datatype datatype to wait for, must have been tracked
+     * @param timeoutMs maximum time to wait
+     *
+     * @return true if the datatype is known, false otherwise
+     */
+    bool waitFor(const std::string& datatype, std::chrono::milliseconds timeoutMs);
+
+    /**
+     * @brief check whether the hub has reported discovery done
+     */
+    bool isDiscoveryDone();
+
+    /**
+     * @brief get the hub ID this catalog is connected to
+     */
+    int getHubId() const { return mHubId; }
+
+    /**
+     * @brief register for catalog changes
+     *
+     * The current content of the catalog is replayed to the new
+     * subscriber as one "added" delta per known datatype before
+     * this call returns, and before any later delta.
+     *
+     * @note must not be called from a subscriber callback
+     *
+     * @param cb subscriber callback
+     *
+     * @return subscription handle for unsubscribe()
+     */
+    int subscribe(suidDeltaCb cb);
+
+    /**
+     * @brief stop receiving catalog changes
+     *
+     * @note a notification already being delivered may still run
+     *       after this call returns.
+     *
+     * @param handle handle returned by subscribe()
+     */
+    void unsubscribe(int handle);
+
+private:
+    /* time given to the hub to answer a request sent after discovery
+       done, before the datatype is considered absent */
+    static constexpr auto ABSENT_GRACE_PERIOD = std::chrono::milliseconds(200);
+
+    struct catalogEntry {
+        bool known = false;
+        bool absent = false;
+        std::chrono::steady_clock::time_point requestTime;
+        std::vector<suid> suids;
+    };
+
+    suidLookUp& getDefaultLookUp();
+    bool isAbsentLocked(const std::string& datatype);
+    bool waitForEntry(std::map<std::string, catalogEntry>& entries,
+        const std::string& datatype, std::chrono::milliseconds timeoutMs);
+    void onSuidEvent(const std::string& datatype, const std::vector<suid>& suids);
+    void onDefaultSuidEvent(const std::string& datatype, const std::vector<suid>& suids);
+    void onDiscoveryDone();
+    void notify(const suidDelta& delta);
+
+    const int mHubId;
+    /* answers of the full suid requests */
+    std::map<std::string, catalogEntry> mCatalog;
+    /* answers of the default-only requests */
+    std::map<std::string, catalogEntry> mDefaults;
+    std::map<int, std::shared_ptr<suidDeltaCb>> mSubscribers;
+    int mNextHandle = 0;
+    bool mDiscoveryDone = false;
+    std::mutex mMutex;
+    /* serializes delta delivery with the replay of subscribe(), taken
+       before mMutex */
+    std::mutex mDispatchMutex;
+    std::condition_variable mConditionVar;
+    std::once_flag mDefaultLookUpOnce;
+    /* must be the last members, so that they are destroyed (and their
+       sessions closed) before the state their callbacks touch */
+    std::unique_ptr<suidLookUp> mLookUp;
+    std::unique_ptr<suidLookUp> mDefaultLookUp;
+};
@@ -28,6 +28,14 @@ using suidEventCb =
     std::function<void(const std::string& datatype,
                        const std::vector<suid>& suids)>;
 
+/**
+ * @brief type alias for the suid discovery done notification
+ *
+ * Called once the hub reports that all sensors which will be
+ * available have been discovered.
+ */
+using suidDiscoveryDoneCb = std::function<void()>;
+
 /**
  * @brief Utility class for discovering available sensors using
  *        dataytpe
@@ -40,8 +48,10 @@ public:
      * @brief creates a new connection to qsh for suid lookup
      *
      * @param cb callback function for suids
+     * @param hubId sensor hub ID to query. Use -1 for default hub
+     * @param doneCb optional callback for the discovery done event
      */
-    suidLookUp(suidEventCb cb, int hubId = -1);
+    suidLookUp(suidEventCb cb, int hubId = -1, suidDiscoveryDoneCb doneCb = nullptr);
     ~suidLookUp();
 
     /**
@@ -52,11 +62,14 @@ public:
      *  @param datatype data type for which suid is requested
      *  @param default_only option to ask for publishing only default
      *         suid for the given data type. default value is false
+     *
+     *  @return 0 if the request was sent, -1 otherwise
      */
-    void requestSuid(std::string datatype, bool defaultOnly = false);
+    int requestSuid(std::string datatype, bool defaultOnly = false);
 
 private:
     suidEventCb mEventCb;
+    suidDiscoveryDoneCb mDoneCb;
     void handleQshEvent(const uint8_t *data, size_t size, uint64_t timeStamp);
     std::unique_ptr<ISession> mSession = nullptr;
     std::unique_ptr<sessionFactory> mSessionFactory = nullptr;
@@ -106,15 +119,37 @@ public:
     std::shared_ptr<std::vector<suid>> lookUp(const std::string& dataYype, int hubId = -1,
         std::chrono::milliseconds timeoutMs = DEFAULT_SUID_LOOKUP_TIMEOUT);
 
+    /**
+     * @brief Looks up the default sensor UID of a datatype
+     *
+     * Served from the process-wide suidCatalog of the hub, so repeated
+     * lookups (including lookups of datatypes absent on this target)
+     * return without a hub round trip and without opening a session.
+     *
+     * @param datatype The sensor datatype to lookup (e.g., "accel")
+     * @param sensorUid Filled with the default sensor UID on success
+     * @param hubId The sensor hub ID to query. Use -1 for default hub (default: -1)
+     * @param timeoutMs Maximum time to wait on a catalog miss (default: 1000ms)
+     *
+     * @return true if a default sensor UID was found, false otherwise
+     */
+    static bool lookUpDefault(const std::string& datatype, suid& sensorUid, int hubId = -1,
+        std::chrono::milliseconds timeoutMs = DEFAULT_SUID_LOOKUP_TIMEOUT);
+
 private:
     void onSuidsAvailable(const std::string& datatype,
         const std::vector<suid>& suids);
+    void onDiscoveryDone();
 
     static constexpr auto DEFAULT_SUID_LOOKUP_TIMEOUT = std::chrono::milliseconds(1000);
+    /* time left to a late suid event once the hub reported discovery done */
+    static constexpr auto DISCOVERY_DONE_GRACE_PERIOD = std::chrono::milliseconds(200);
 
     std::shared_ptr<std::vector<suid>> mSuids;
 
     bool mLookupDone = false;
+    bool mDiscoveryDone = false;
+    std::chrono::steady_clock::time_point mDiscoveryDoneTime;
     std::mutex mMutex;
     std::condition_variable mConditionVar;
 };
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <string>
+#include <cinttypes>
+#include "sns_client.pb.h"
+#include "sns_std.pb.h"
+#include "qshLog.h"
+#include "qshAttributeCache.h"
+
+using namespace std;
+
+qshAttributeCache::qshAttributeCache(int hubId)
+{
+  mSessionFactory = make_unique<sessionFactory>();
+  if (nullptr == mSessionFactory) {
+    sns_loge("failed to create sessionFactory");
+    return;
+  }
+  try {
+    if (-1 == hubId) {
+      mSession = unique_ptr<ISession>(mSessionFactory->getSession());
+    } else {
+      mSession = unique_ptr<ISession>(mSessionFactory->getSession(hubId));
+    }
+  } catch (const std::exception& e) {
+    sns_loge("Exception creating session: %s", e.what());
+    mSession = nullptr;
+  } catch (...) {
+    sns_loge("Unknown exception creating session");
+    mSession = nullptr;
+  }
+  if (nullptr == mSession) {
+    sns_loge("failed to create ISession");
+    mSessionFactory.reset();
+    return;
+  }
+  if (0 != mSession->open()) {
+    sns_loge("failed to open ISession for attribute queries");
+    mSession.reset();
+    mSessionFactory.reset();
+  }
+}
+
+qshAttributeCache::~qshAttributeCache()
+{
+  if (nullptr != mSession) {
+    mSession->close();
+  }
+}
+
+bool qshAttributeCache::sendAttrRequest(const suid& sensorUid, bool setCallBacks)
+{
+  if (nullptr == mSession) {
+    sns_loge("attribute session is not available");
+    return false;
+  }
+
+  if (setCallBacks) {
+    ISession::eventCallBack eventCallBack =
+        [this, sensorUid](const uint8_t* msg, size_t msgLength, uint64_t timeStamp)
+        { this->handleQshEvent(sensorUid, msg, msgLength); };
+    if (0 != mSession->setCallBacks(sensorUid, nullptr, nullptr, eventCallBack)) {
+      sns_loge("failed to set callbacks");
+      return false;
+    }
+  }
+
+  sns_std_suid _suid = {.suid_low = sensorUid.low, .suid_high = sensorUid.high};
+  sns_client_request_msg request_msg = sns_client_request_msg_init_default;
+  request_msg.suid = _suid;
+  request_msg.msg_id = SNS_STD_MSGID_SNS_STD_ATTR_REQ;
+  request_msg.susp_config.client_proc_type = SNS_STD_CLIENT_PROCESSOR_APSS;
+  request_msg.susp_config.delivery_type = SNS_CLIENT_DELIVERY_WAKEUP;
+  request_msg.request.payload.funcs.encode = nullptr;
+  request_msg.has_client_tech = true;
+  request_msg.client_tech = SNS_TECH_SENSORS;
+
+  pb_byte_t buffer[256];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  if (!pb_encode(&stream, sns_client_request_msg_fields, &request_msg)) {
+    sns_loge("attr: Failed to encode sns_client_request: %s", PB_GET_ERROR(&stream));
+    return false;
+  }
+  std::string encoded_string(reinterpret_cast<char*>(buffer), stream.bytes_written);
+
+  sns_logd("requesting attributes for suid = [%" PRIx64 " %" PRIx64 "]",
+           sensorUid.high, sensorUid.low);
+  if (0 != mSession->sendRequest(sensorUid, encoded_string)) {
+    sns_loge("Error in sending attribute request");
+    return false;
+  }
+  return true;
+}
+
+void qshAttributeCache::fetch(std::unique_lock<std::mutex>& lk, const suid& sensorUid)
+{
+  attrEntry& entry = mEntries[sensorUid];
+  if (fetchState::IDLE != entry.state) {
+    return;
+  }
+  entry.state = fetchState::PENDING;
+  entry.generation++;
+  bool setCallBacks = !entry.callbacksSet;
+  entry.callbacksSet = true;
+
+  /* the hub may deliver the event before sendRequest() returns, so the
+     lock must not be held while talking to the session */
+  lk.unlock();
+  bool sent = sendAttrRequest(sensorUid, setCallBacks);
+  lk.lock();
+
+  if (!sent) {
+    attrEntry& failed = mEntries[sensorUid];
+    if (setCallBacks) {
+      failed.callbacksSet = false;
+    }
+    if (fetchState::PENDING == failed.state) {
+      failed.state = fetchState::IDLE;
+    }
+    mConditionVar.notify_all();
+  }
+}
+
+bool qshAttributeCache::waitReady(std::unique_lock<std::mutex>& lk, const suid& sensorUid,
+    std::chrono::milliseconds timeoutMs)
+{
+  const auto then = std::chrono::steady_clock::now() + timeoutMs;
+  attrEntry* entry = mEntries.find(sensorUid);
+  if (nullptr == entry || fetchState::IDLE == entry->state) {
+    /* request could not be sent */
+    return false;
+  }
+  if (fetchState::READY == entry->state) {
+    return true;
+  }
+  const uint64_t generation = entry->generation;
+  entry->waiters++;
+
+  bool ready = false;
+  while (true) {
+    /* entries are not erased, but may move while the lock is released */
+    entry = mEntries.find(sensorUid);
+    if (fetchState::READY == entry->state) {
+      ready = true;
+      break;
+    }
+    if (fetchState::IDLE == entry->state || generation != entry->generation) {
+      /* request failed, or was dropped by invalidate() */
+      break;
+    }
+    if (mConditionVar.wait_until(lk, then) == std::cv_status::timeout) {
+      entry = mEntries.find(sensorUid);
+      if (fetchState::READY == entry->state) {
+        ready = true;
+        break;
+      }
+      sns_loge("attribute lookup timeout(%lld ms) for suid = [%" PRIx64 " %" PRIx64 "]",
+               (long long)timeoutMs.count(), sensorUid.high, sensorUid.low);
+      /* the last waiter of the request allows the next access to retry,
+         others may still be within their deadline. A late event still
+         fills the cache. */
+      if (1 == entry->waiters && generation == entry->generation &&
+          fetchState::PENDING == entry->state) {
+        entry->state = fetchState::IDLE;
+      }
+      break;
+    }
+  }
+  entry->waiters--;
+  return ready;
+}
+
+bool qshAttributeCache::getAttributes(const suid& sensorUid, qshPb::sensor_attributes& attrs,
+    std::chrono::milliseconds timeoutMs)
+{
+  unique_lock<mutex> lk(mMutex);
+  fetch(lk, sensorUid);
+  if (!waitReady(lk, sensorUid, timeoutMs)) {
+    return false;
+  }
+  attrs = mEntries[sensorUid].attrs;
+  return true;
+}
+
+bool qshAttributeCache::getAttribute(const suid& sensorUid, int32_t attrId,
+    qshPb::attributes& values, std::chrono::milliseconds timeoutMs)
+{
+  unique_lock<mutex> lk(mMutex);
+  fetch(lk, sensorUid);
+  if (!waitReady(lk, sensorUid, timeoutMs)) {
+    return false;
+  }
+  const qshPb::sensor_attributes& attrs = mEntries[sensorUid].attrs;
+  auto it = attrs.find(attrId);
+  if (it == attrs.end()) {
+    return false;
+  }
+  values = it->second;
+  return true;
+}
+
+bool qshAttributeCache::getKnownAttributes(const suid& sensorUid, qshPb::sensor_attributes& attrs)
+{
+  lock_guard<mutex> lk(mMutex);
+  const attrEntry* entry = mEntries.find(sensorUid);
+  if (nullptr == entry) {
+    attrs.clear();
+    return false;
+  }
+  attrs = entry->attrs;
+  return fetchState::READY == entry->state;
+}
+
+void qshAttributeCache::prefetch(const suid& sensorUid)
+{
+  unique_lock<mutex> lk(mMutex);
+  fetch(lk, sensorUid);
+}
+
+void qshAttributeCache::invalidate(const suid& sensorUid)
+{
+  lock_guard<mutex> lk(mMutex);
+  attrEntry* entry = mEntries.find(sensorUid);
+  if (nullptr == entry) {
+    return;
+  }
+  /* keep the entry so callbacks are not registered twice */
+  entry->state = fetchState::IDLE;
+  entry->generation++;
+  entry->attrs.clear();
+  mConditionVar.notify_all();
+}
+
+void qshAttributeCache::handleQshEvent(const suid& sensorUid, const uint8_t *data, size_t size)
+{
+  qshPb::sensor_attributes attrs;
+  pb_istream_t stream = pb_istream_from_buffer((const pb_byte_t *)data, size);
+  sns_client_event_msg event = sns_client_event_msg_init_default;
+  event.events.funcs.decode = &qshPb::decode_attributes;
+  event.events.arg = &attrs;
+
+  if (!pb_decode(&stream, sns_client_event_msg_fields, &event)) {
+    sns_loge("attr: sns_client_event decoding failed %s", PB_GET_ERROR(&stream));
+    return;
+  }
+  if (attrs.empty()) {
+    /* not an attribute event */
+    return;
+  }
+
+  lock_guard<mutex> lk(mMutex);
+  attrEntry& entry = mEntries[sensorUid];
+  for (auto& attr : attrs) {
+    entry.attrs[attr.first] = std::move(attr.second);
+  }
+  entry.state = fetchState::READY;
+  sns_logd("%zu attribute(s) cached for suid = [%" PRIx64 " %" PRIx64 "]",
+           entry.attrs.size(), sensorUid.high, sensorUid.low);
+  mConditionVar.notify_all();
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cinttypes>
+#include <cstdio>
+#include "qshLog.h"
+#include "sns_client.pb.h"
+#include "sns_direct_channel.pb.h"
+#include "qshChannelLatency.h"
+
+using namespace std;
+
+constexpr size_t qshChannelLatency::WINDOW_SLOTS;
+constexpr uint64_t qshChannelLatency::SLOT_NS;
+
+qshChannelLatency::qshChannelLatency(qshTimeUtil& timeUtil) : mTimeUtil(timeUtil)
+{
+}
+
+bool qshChannelLatency::decodeReport(const uint8_t* payload, size_t size, report& rep)
+{
+    /* all fields are fixed size, nanopb decodes them in place */
+    sns_generic_channel_latency_msg msg = sns_generic_channel_latency_msg_init_default;
+    pb_istream_t stream = pb_istream_from_buffer((const pb_byte_t*)payload, size);
+    if (!pb_decode(&stream, sns_generic_channel_latency_msg_fields, &msg)) {
+        sns_loge("channel latency: decoding failed %s", PB_GET_ERROR(&stream));
+        return false;
+    }
+    rep.sampleCount = msg.sample_count;
+    rep.maxLatencyTs = msg.max_latency_ts;
+    rep.maxLatencyUs = msg.max_latency;
+    rep.avgLatencyUs = msg.avg_latency;
+    return true;
+}
+
+bool qshChannelLatency::decodeEvent(pb_istream_t* stream, const pb_field_t* /*field*/, void** arg)
+{
+    auto* ctx = static_cast<decodeContext*>(*arg);
+    sns_client_event_msg_sns_client_event event =
+        sns_client_event_msg_sns_client_event_init_default;
+    qshPb::pb_buffer_arg payload{};
+    event.payload.funcs.decode = &qshPb::decode_payload;
+    event.payload.arg = &payload;
+
+    if (!pb_decode(stream, sns_client_event_msg_sns_client_event_fields, &event)) {
+        sns_loge("channel latency: sns_client_event decoding failed %s", PB_GET_ERROR(stream));
+        return false;
+    }
+    if (SNS_DIRECT_CHANNEL_MSGID_SNS_GENERIC_CHANNEL_LATENCY_MSG != event.msg_id) {
+        return true;
+    }
+    report rep;
+    if (nullptr == payload.buf ||
+        !decodeReport((const uint8_t*)payload.buf, payload.buf_len, rep)) {
+        /* skip the report, keep decoding the other events */
+        return true;
+    }
+    ctx->self->addReport(*ctx->sensorUid, rep);
+    ctx->reports++;
+    return true;
+}
+
+size_t qshChannelLatency::handleEvent(const suid& sensorUid, const uint8_t* data, size_t size)
+{
+    decodeContext ctx{this, &sensorUid, 0};
+    sns_client_event_msg event = sns_client_event_msg_init_default;
+    event.events.funcs.decode = &decodeEvent;
+    event.events.arg = &ctx;
+
+    pb_istream_t stream = pb_istream_from_buffer((const pb_byte_t*)data, size);
+    if (!pb_decode(&stream, sns_client_event_msg_fields, &event)) {
+        sns_loge("channel latency: sns_client_event_msg decoding failed %s",
+                 PB_GET_ERROR(&stream));
+    }
+    return ctx.reports;
+}
+
+bool qshChannelLatency::handleReport(const suid& sensorUid, const uint8_t* payload, size_t size)
+{
+    report rep;
+    if (!decodeReport(payload, size, rep)) {
+        return false;
+    }
+    addReport(sensorUid, rep);
+    return true;
+}
+
+ISession::eventCallBack qshChannelLatency::wrapEventCallBack(const suid& sensorUid,
+                                                             ISession::eventCallBack cb)
+{
+    {
+        lock_guard<mutex> lk(mMutex);
+        mChannels[sensorUid];
+    }
+    return [this, sensorUid, cb](const uint8_t* data, size_t size, uint64_t timestamp) {
+        handleEvent(sensorUid, data, size);
+        if (nullptr != cb) {
+            cb(data, size, timestamp);
+        }
+    };
+}
+
+void qshChannelLatency::removeChannel(const suid& sensorUid)
+{
+    lock_guard<mutex> lk(mMutex);
+    mChannels.erase(sensorUid);
+}
+
+void qshChannelLatency::addReport(const suid& sensorUid, const report& rep)
+{
+    /* slot indexes start at 1, 0 marks an empty slot */
+    uint64_t index = mTimeUtil.qtimerGetTimeNs() / SLOT_NS + 1;
+    uint64_t latencySumUs = uint64_t(rep.avgLatencyUs) * rep.sampleCount;
+
+    lock_guard<mutex> lk(mMutex);
+    channel& ch = mChannels[sensorUid];
+    ch.reports++;
+    ch.samples += rep.sampleCount;
+    ch.latencySumUs += latencySumUs;
+    if (rep.maxLatencyUs >= ch.maxLatencyUs) {
+        ch.maxLatencyUs = rep.maxLatencyUs;
+        ch.maxLatencyTs = rep.maxLatencyTs;
+    }
+    slot& s = ch.window[index % WINDOW_SLOTS];
+    if (s.index != index) {
+        s = slot();
+        s.index = index;
+    }
+    s.samples += rep.sampleCount;
+    s.latencySumUs += latencySumUs;
+    if (rep.maxLatencyUs > s.maxLatencyUs) {
+        s.maxLatencyUs = rep.maxLatencyUs;
+    }
+}
+
+vector<qshChannelLatencySnapshot> qshChannelLatency::getSnapshots(qshLatencyMonitor* host)
+{
+    uint64_t index = mTimeUtil.qtimerGetTimeNs() / SLOT_NS + 1;
+    vector<qshChannelLatencySnapshot> snaps;
+    {
+        lock_guard<mutex> lk(mMutex);
+        for (auto& entry : mChannels) {
+            const channel& ch = entry.second;
+            qshChannelLatencySnapshot snap;
+            snap.sensorUid = entry.first;
+            snap.reports = ch.reports;
+            snap.samples = ch.samples;
+            snap.avgLatencyUs = (0 != ch.samples) ? uint32_t(ch.latencySumUs / ch.samples) : 0;
+            snap.maxLatencyUs = ch.maxLatencyUs;
+            snap.maxLatencyTs = ch.maxLatencyTs;
+            uint64_t windowSumUs = 0;
+            for (const slot& s : ch.window) {
+                if (0 == s.index || s.index + WINDOW_SLOTS <= index) {
+                    continue;
+                }
+                snap.windowSamples += s.samples;
+                windowSumUs += s.latencySumUs;
+                if (s.maxLatencyUs > snap.windowMaxLatencyUs) {
+                    snap.windowMaxLatencyUs = s.maxLatencyUs;
+                }
+            }
+            snap.windowAvgLatencyUs = (0 != snap.windowSamples) ?
+                uint32_t(windowSumUs / snap.windowSamples) : 0;
+            snaps.push_back(snap);
+        }
+    }
+    if (nullptr != host) {
+        for (qshChannelLatencySnapshot& snap : snaps) {
+            int handle = host->findHandle(snap.sensorUid);
+            snap.hasHost = (-1 != handle) && host->getSnapshot(handle, snap.host);
+        }
+    }
+    return snaps;
+}
+
+void qshChannelLatency::reset()
+{
+    lock_guard<mutex> lk(mMutex);
+    mChannels.clear();
+}
+
+void qshChannelLatency::logStats(qshLatencyMonitor* host)
+{
+    for (const qshChannelLatencySnapshot& snap : getSnapshots(host)) {
+        sns_logi("channel latency suid = [%" PRIx64 " %" PRIx64 "] reports = %" PRIu64
+                 " samples = %" PRIu64 " hub avg = %" PRIu32 " max = %" PRIu32
+                 " us, window avg = %" PRIu32 " max = %" PRIu32 " us, host p50 = %" PRIu64
+                 " p99 = %" PRIu64 " max = %" PRIu64 " ns", snap.sensorUid.high,
+                 snap.sensorUid.low, snap.reports, snap.samples, snap.avgLatencyUs,
+                 snap.maxLatencyUs, snap.windowAvgLatencyUs, snap.windowMaxLatencyUs,
+                 snap.host.p50Ns, snap.host.p99Ns, snap.host.maxNs);
+    }
+}
+
+string qshChannelLatency::exportCsv(qshLatencyMonitor* host)
+{
+    string csv = "suid,reports,samples,hub_avg_us,hub_max_us,hub_max_ts_ns,window_samples,"
+                 "window_avg_us,window_max_us,host_events,host_p50_ns,host_p99_ns,"
+                 "host_p999_ns,host_max_ns\n";
+    char line[384];
+    for (const qshChannelLatencySnapshot& snap : getSnapshots(host)) {
+        snprintf(line, sizeof(line), "%016" PRIx64 "%016" PRIx64 ",%" PRIu64 ",%" PRIu64
+                 ",%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%" PRIu32 ",%" PRIu32
+                 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                 snap.sensorUid.high, snap.sensorUid.low, snap.reports, snap.samples,
+                 snap.avgLatencyUs, snap.maxLatencyUs, snap.maxLatencyTs, snap.windowSamples,
+                 snap.windowAvgLatencyUs, snap.windowMaxLatencyUs, snap.host.events,
+                 snap.host.p50Ns, snap.host.p99Ns, snap.host.p999Ns, snap.host.maxNs);
+        csv += line;
+    }
+    return csv;
+}
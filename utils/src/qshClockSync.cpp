@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cinttypes>
+#include "qshLog.h"
+#include "qshClockSync.h"
+
+using namespace std;
+
+constexpr size_t qshClockSync::HISTORY;
+constexpr chrono::nanoseconds qshClockSync::DEFAULT_PERIOD;
+
+qshClockSync::qshClockSync(chrono::nanoseconds period, qshTimeUtil& timeUtil) :
+    mTimeUtil(timeUtil),
+    mPeriod(period.count() > 0 ? period : DEFAULT_PERIOD)
+{
+    mWorker.setName("qshClockSync");
+}
+
+qshClockSync::~qshClockSync()
+{
+    stop();
+    /* a sync may still be running, it uses the members below */
+    mWorker.shutdownWorker();
+}
+
+bool qshClockSync::start()
+{
+    lock_guard<mutex> lk(mMutex);
+    if (mRunning) {
+        return false;
+    }
+    mTimer = mWorker.addPeriodicTask(mPeriod, [this] { sync(); });
+    if (QSH_INVALID_TIMER == mTimer) {
+        sns_loge("failed to schedule clock sync");
+        return false;
+    }
+    mRunning = true;
+    mTimeUtil.setExternalSync(true);
+    mWorker.addTask([this] { sync(); });
+    sns_logi("clock sync started, period = %" PRId64 " ms",
+             int64_t(chrono::duration_cast<chrono::milliseconds>(mPeriod).count()));
+    return true;
+}
+
+void qshClockSync::stop()
+{
+    lock_guard<mutex> lk(mMutex);
+    if (!mRunning) {
+        return;
+    }
+    mWorker.cancelTimer(mTimer);
+    mTimer = QSH_INVALID_TIMER;
+    mRunning = false;
+    mTimeUtil.setExternalSync(false);
+}
+
+bool qshClockSync::isRunning()
+{
+    lock_guard<mutex> lk(mMutex);
+    return mRunning;
+}
+
+bool qshClockSync::setPeriod(chrono::nanoseconds period)
+{
+    if (period.count() <= 0) {
+        sns_loge("invalid clock sync period");
+        return false;
+    }
+    lock_guard<mutex> lk(mMutex);
+    mPeriod = period;
+    if (mRunning) {
+        mWorker.cancelTimer(mTimer);
+        mTimer = mWorker.addPeriodicTask(mPeriod, [this] { sync(); });
+    }
+    return true;
+}
+
+void qshClockSync::syncNow()
+{
+    mWorker.addTask([this] { sync(); });
+}
+
+void qshClockSync::setSyncCallBack(clockSyncCallBack cb)
+{
+    lock_guard<mutex> lk(mMutex);
+    mSyncCallBack = std::move(cb);
+}
+
+int qshClockSync::setThreadAttr(const qshThreadAttr& attr)
+{
+    return mWorker.setThreadAttr(attr);
+}
+
+void qshClockSync::sync()
+{
+    uint64_t slewPeriodNs;
+    {
+        lock_guard<mutex> lk(mMutex);
+        slewPeriodNs = uint64_t(mPeriod.count());
+    }
+    qshTimeSyncSample sample;
+    bool valid = mTimeUtil.syncOffset(sample, slewPeriodNs);
+
+    unique_lock<mutex> lk(mMutex);
+    if (!valid) {
+        mStats.failures++;
+        sns_loge("clock sync failed");
+        return;
+    }
+    mGaps[(mGapsFirst + mGapsCount) % HISTORY] = sample.gapNs;
+    if (mGapsCount < HISTORY) {
+        mGapsCount++;
+    } else {
+        mGapsFirst = (mGapsFirst + 1) % HISTORY;
+    }
+    uint64_t minGap = sample.gapNs;
+    for (size_t idx = 0; idx < mGapsCount; idx++) {
+        if (mGaps[idx] < minGap) {
+            minGap = mGaps[idx];
+        }
+    }
+
+    mStats.syncs++;
+    if (sample.stepped) {
+        mStats.steps++;
+    }
+    mStats.offsetNs = sample.offsetNs;
+    mStats.driftPpm = sample.rate * 1e6;
+    mStats.lastGapNs = sample.gapNs;
+    mStats.minGapNs = minGap;
+    mStats.jitterNs = sample.residualNs;
+    /* the reading is somewhere within the gap */
+    mStats.uncertaintyNs = double(sample.gapNs) / 2.0 + sample.residualNs;
+    mStats.lastSyncRealtimeNs = sample.realtimeNs;
+    mStats.windowSize = mGapsCount;
+    if (sample.stepped) {
+        sns_logi("clock sync stepped, offset = %" PRId64, sample.offsetNs);
+    }
+    clockSyncCallBack cb = mSyncCallBack;
+    qshClockSyncStats stats = mStats;
+    lk.unlock();
+    if (nullptr != cb) {
+        cb(stats);
+    }
+}
+
+qshClockSyncStats qshClockSync::getStats()
+{
+    lock_guard<mutex> lk(mMutex);
+    return mStats;
+}
+
+void qshClockSync::logStats()
+{
+    qshClockSyncStats stats = getStats();
+    sns_logi("clock sync: syncs = %" PRIu64 " failures = %" PRIu64 " steps = %" PRIu64
+             " offset = %" PRId64 " drift = %.3f ppm gap = %" PRIu64 "/%" PRIu64
+             " ns jitter = %.1f ns uncertainty = %.1f ns", stats.syncs, stats.failures,
+             stats.steps, stats.offsetNs, stats.driftPpm, stats.lastGapNs, stats.minGapNs,
+             stats.jitterNs, stats.uncertaintyNs);
+}
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include "qshCoSession.h"
+
+#ifdef QSH_HAS_COROUTINES
+#include <algorithm>
+#include <cinttypes>
+
+using namespace std;
+using namespace std::chrono;
+
+qshCoSession::qshCoSession(int hubId) : mHubId(hubId)
+{
+    mBlockingWorker.setName("qshCoSession");
+    mSessionFactory = make_unique<sessionFactory>();
+    try {
+        if (-1 == hubId) {
+            mSession = unique_ptr<ISession>(mSessionFactory->getSession());
+        } else {
+            mSession = unique_ptr<ISession>(mSessionFactory->getSession(hubId));
+        }
+    } catch (const std::exception& e) {
+        sns_loge("Exception creating session: %s", e.what());
+        mSession = nullptr;
+    } catch (...) {
+        sns_loge("Unknown exception creating session");
+        mSession = nullptr;
+    }
+    if (nullptr == mSession) {
+        sns_loge("failed to create ISession");
+    }
+}
+
+qshCoSession::~qshCoSession()
+{
+    /* a pending open() must not race with close() */
+    mBlockingWorker.shutdownWorker();
+    vector<openAwaiter*> opens;
+    {
+        lock_guard<mutex> lk(mMutex);
+        opens.swap(mPendingOpens);
+    }
+    /* their tasks were dropped by the shutdown */
+    for (openAwaiter* w : opens) {
+        w->result = -1;
+        w->executor->post(w->handle);
+    }
+    close();
+}
+
+int qshCoSession::openSession()
+{
+    if (nullptr == mSession) {
+        return -1;
+    }
+    {
+        lock_guard<mutex> lk(mMutex);
+        if (mOpen) {
+            return 0;
+        }
+    }
+    if (0 != mSession->open()) {
+        sns_loge("failed to open session");
+        return -1;
+    }
+    lock_guard<mutex> lk(mMutex);
+    mOpen = true;
+    return 0;
+}
+
+void qshCoSession::startOpen(openAwaiter* w)
+{
+    {
+        lock_guard<mutex> lk(mMutex);
+        mPendingOpens.push_back(w);
+    }
+    mBlockingWorker.addTask([this, w]() {
+        int result = openSession();
+        {
+            lock_guard<mutex> lk(mMutex);
+            mPendingOpens.erase(std::find(mPendingOpens.begin(), mPendingOpens.end(), w));
+        }
+        w->result = result;
+        w->executor->post(w->handle);
+    });
+}
+
+void qshCoSession::close()
+{
+    vector<shared_ptr<channel>> channels;
+    {
+        lock_guard<mutex> lk(mMutex);
+        if (!mOpen) {
+            return;
+        }
+        mOpen = false;
+        for (auto& entry : mChannels) {
+            channels.push_back(entry.second);
+        }
+        mChannels.clear();
+    }
+    mSession->close();
+    for (auto& ch : channels) {
+        failWaiters(*ch);
+    }
+}
+
+uint64_t qshCoSession::getDroppedEvents()
+{
+    lock_guard<mutex> lk(mMutex);
+    uint64_t dropped = 0;
+    for (auto& entry : mChannels) {
+        lock_guard<mutex> chLock(entry.second->mutex);
+        dropped += entry.second->droppedEvents;
+    }
+    return dropped;
+}
+
+shared_ptr<qshCoSession::channel> qshCoSession::getChannel(const suid& sensorUid)
+{
+    lock_guard<mutex> lk(mMutex);
+    if (!mOpen) {
+        return nullptr;
+    }
+    auto it = mChannels.find(sensorUid);
+    if (it != mChannels.end()) {
+        return it->second;
+    }
+
+    auto ch = make_shared<channel>();
+    ISession::respCallBack respCB = [this, ch](const uint32_t respValue, uint64_t clientConnectID)
+        { this->onResponse(*ch, respValue, clientConnectID); };
+    ISession::errorCallBack errorCB = [this, ch](ISession::error error)
+        { this->onError(*ch, error); };
+    ISession::eventCallBack eventCB = [this, ch](const uint8_t* data, size_t size, uint64_t timestamp)
+        { this->onEvent(*ch, data, size, timestamp); };
+    if (0 != mSession->setCallBacks(sensorUid, respCB, errorCB, eventCB)) {
+        sns_loge("failed to set callbacks for suid = [%" PRIx64 " %" PRIx64 "]",
+                 sensorUid.high, sensorUid.low);
+        return nullptr;
+    }
+    mChannels.emplace(sensorUid, ch);
+    return ch;
+}
+
+bool qshCoSession::startRequest(const suid& sensorUid, const string& message, waiter* w)
+{
+    shared_ptr<channel> ch = getChannel(sensorUid);
+    if (nullptr == ch) {
+        return false;
+    }
+    {
+        lock_guard<mutex> lk(ch->mutex);
+        ch->responseWaiters.push_back(w);
+    }
+    if (0 == mSession->sendRequest(sensorUid, message)) {
+        return true;
+    }
+
+    sns_loge("failed to send request to suid = [%" PRIx64 " %" PRIx64 "]",
+             sensorUid.high, sensorUid.low);
+    lock_guard<mutex> lk(ch->mutex);
+    auto it = std::find(ch->responseWaiters.begin(), ch->responseWaiters.end(), w);
+    if (it == ch->responseWaiters.end()) {
+        /* already failed by close() or an error, which resumes it */
+        return true;
+    }
+    ch->responseWaiters.erase(it);
+    return false;
+}
+
+bool qshCoSession::startNextEvent(const suid& sensorUid, waiter* w)
+{
+    shared_ptr<channel> ch = getChannel(sensorUid);
+    if (nullptr == ch) {
+        return false;
+    }
+    lock_guard<mutex> lk(ch->mutex);
+    if (!ch->events.empty()) {
+        w->event = std::move(ch->events.front());
+        ch->events.pop_front();
+        return false;
+    }
+    ch->eventWaiters.push_back(w);
+    return true;
+}
+
+void qshCoSession::onResponse(channel& ch, uint32_t respValue, uint64_t clientConnectID)
+{
+    waiter* w;
+    {
+        lock_guard<mutex> lk(ch.mutex);
+        if (ch.responseWaiters.empty()) {
+            sns_logd("response %" PRIu32 " without pending request", respValue);
+            return;
+        }
+        w = ch.responseWaiters.front();
+        ch.responseWaiters.pop_front();
+    }
+    w->response.received = true;
+    w->response.respValue = respValue;
+    w->response.clientConnectID = clientConnectID;
+    w->executor->post(w->handle);
+}
+
+void qshCoSession::onEvent(channel& ch, const uint8_t* data, size_t size, uint64_t timestamp)
+{
+    qshCoEvent event;
+    event.valid = true;
+    event.data.assign(data, data + size);
+    event.timestamp = timestamp;
+
+    waiter* w;
+    {
+        lock_guard<mutex> lk(ch.mutex);
+        if (ch.eventWaiters.empty()) {
+            if (ch.events.size() >= MAX_BUFFERED_EVENTS) {
+                if (0 == ch.droppedEvents++) {
+                    sns_loge("event buffer full, dropping oldest events");
+                }
+                ch.events.pop_front();
+            }
+            ch.events.push_back(std::move(event));
+            return;
+        }
+        w = ch.eventWaiters.front();
+        ch.eventWaiters.pop_front();
+    }
+    w->event = std::move(event);
+    w->executor->post(w->handle);
+}
+
+void qshCoSession::onError(channel& ch, ISession::error error)
+{
+    sns_loge("session error %d, failing pending awaits", (int)error);
+    failWaiters(ch);
+}
+
+void qshCoSession::failWaiters(channel& ch)
+{
+    deque<waiter*> waiters;
+    {
+        lock_guard<mutex> lk(ch.mutex);
+        waiters.swap(ch.responseWaiters);
+        waiters.insert(waiters.end(), ch.eventWaiters.begin(), ch.eventWaiters.end());
+        ch.eventWaiters.clear();
+    }
+    for (waiter* w : waiters) {
+        w->executor->post(w->handle);
+    }
+}
+
+bool qshCoSession::lookUpState::tryComplete()
+{
+    catalog->track(datatype);
+    if (catalog->getSuids(datatype, suids)) {
+        return true;
+    }
+    return catalog->isAbsent(datatype);
+}
+
+void qshCoSession::startLookUp(const shared_ptr<lookUpState>& state)
+{
+    state->deadline = steady_clock::now() + state->timeout;
+    int subscription = state->catalog->subscribe([state](const suidDelta& delta) {
+        if (delta.datatype == state->datatype && !delta.added.empty()) {
+            finishLookUp(state);
+        }
+    });
+    {
+        lock_guard<mutex> lk(state->mutex);
+        if (!state->done) {
+            state->subscription = subscription;
+            state->subscribed = true;
+            subscription = -1;
+        }
+    }
+    if (-1 != subscription) {
+        /* completed by the replay of the catalog */
+        state->catalog->unsubscribe(subscription);
+        return;
+    }
+    state->executor->postDelayed(std::min<nanoseconds>(LOOKUP_RECHECK_DELAY, state->timeout),
+        [state]() { checkLookUp(state); });
+}
+
+void qshCoSession::checkLookUp(const shared_ptr<lookUpState>& state)
+{
+    {
+        lock_guard<mutex> lk(state->mutex);
+        if (state->done) {
+            return;
+        }
+    }
+    /* flags the datatype absent once the catalog's grace period for
+       late requests is over */
+    if (state->catalog->waitFor(state->datatype, milliseconds(0)) ||
+        state->catalog->isAbsent(state->datatype)) {
+        finishLookUp(state);
+        return;
+    }
+    auto now = steady_clock::now();
+    if (now >= state->deadline) {
+        sns_logi("lookup of datatype %s timed out", state->datatype.c_str());
+        finishLookUp(state);
+        return;
+    }
+    state->executor->postDelayed(std::min<nanoseconds>(LOOKUP_RECHECK_DELAY, state->deadline - now),
+        [state]() { checkLookUp(state); });
+}
+
+void qshCoSession::finishLookUp(const shared_ptr<lookUpState>& state)
+{
+    int subscription = -1;
+    {
+        lock_guard<mutex> lk(state->mutex);
+        if (state->done) {
+            return;
+        }
+        state->done = true;
+        if (state->subscribed) {
+            subscription = state->subscription;
+        }
+    }
+    state->catalog->getSuids(state->datatype, state->suids);
+    if (-1 != subscription) {
+        state->catalog->unsubscribe(subscription);
+    }
+    state->executor->post(state->handle);
+}
+
+#endif /* QSH_HAS_COROUTINES */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cinttypes>
+#include "qshLog.h"
+#include "qshPb.h"
+#include "sns_direct_channel.pb.h"
+#include "qshDirectChannelTsSync.h"
+
+using namespace std;
+
+constexpr int64_t qshDirectChannelTsSync::DEFAULT_THRESHOLD_NS;
+constexpr size_t qshDirectChannelTsSync::MAX_CONFIG_MSG_LEN;
+
+qshDirectChannelTsSync::qshDirectChannelTsSync(int64_t thresholdNs, qshTimeUtil& timeUtil) :
+    mTimeUtil(timeUtil),
+    mThresholdNs(thresholdNs > 0 ? thresholdNs : DEFAULT_THRESHOLD_NS),
+    mNsToTicks(1000000000ull, timeUtil.qtimerGetFreq())
+{
+}
+
+int qshDirectChannelTsSync::addChannel(directChannelConfigSender sender)
+{
+    if (nullptr == sender) {
+        sns_loge("invalid direct channel sender");
+        return -1;
+    }
+    int64_t offsetNs, offsetTicks;
+    getOffset(offsetNs, offsetTicks);
+
+    lock_guard<mutex> lk(mMutex);
+    int handle = mNextHandle++;
+    channel& ch = mChannels[handle];
+    ch.sender = std::move(sender);
+    push(handle, ch, offsetNs, offsetTicks);
+    return handle;
+}
+
+void qshDirectChannelTsSync::removeChannel(int handle)
+{
+    lock_guard<mutex> lk(mMutex);
+    mChannels.erase(handle);
+}
+
+size_t qshDirectChannelTsSync::update(bool force)
+{
+    int64_t offsetNs, offsetTicks;
+    getOffset(offsetNs, offsetTicks);
+
+    size_t pushed = 0;
+    lock_guard<mutex> lk(mMutex);
+    for (auto& entry : mChannels) {
+        channel& ch = entry.second;
+        int64_t diff = offsetNs - ch.offsetNs;
+        if (!force && ch.pushed && diff <= mThresholdNs && diff >= -mThresholdNs) {
+            continue;
+        }
+        if (push(entry.first, ch, offsetNs, offsetTicks)) {
+            pushed++;
+        }
+    }
+    return pushed;
+}
+
+bool qshDirectChannelTsSync::getChannelOffset(int handle, int64_t& offsetTicks)
+{
+    lock_guard<mutex> lk(mMutex);
+    auto it = mChannels.find(handle);
+    if (it == mChannels.end() || !it->second.pushed) {
+        return false;
+    }
+    offsetTicks = it->second.offsetTicks;
+    return true;
+}
+
+void qshDirectChannelTsSync::getOffset(int64_t& offsetNs, int64_t& offsetTicks)
+{
+    qshTimeMapping mapping = mTimeUtil.getTimeMapping();
+    offsetNs = mapping.offsetAt(mTimeUtil.qtimerGetTimeNs());
+    offsetTicks = nsToTicks(offsetNs);
+}
+
+int64_t qshDirectChannelTsSync::nsToTicks(int64_t ns) const
+{
+    if (ns < 0) {
+        return -int64_t(mNsToTicks.convert(uint64_t(-ns)));
+    }
+    return int64_t(mNsToTicks.convert(uint64_t(ns)));
+}
+
+bool qshDirectChannelTsSync::push(int handle, channel& ch, int64_t offsetNs, int64_t offsetTicks)
+{
+    uint8_t msg[MAX_CONFIG_MSG_LEN];
+    size_t msgLen = 0;
+    if (!encodeTsOffset(offsetTicks, msg, sizeof(msg), msgLen)) {
+        return false;
+    }
+    if (0 != ch.sender(msg, msgLen)) {
+        sns_loge("failed to set ts offset of direct channel %d", handle);
+        ch.pushed = false;
+        return false;
+    }
+    sns_logd("direct channel %d ts offset = %" PRId64 " ticks (%" PRId64 " ns)", handle,
+             offsetTicks, offsetNs);
+    ch.pushed = true;
+    ch.offsetNs = offsetNs;
+    ch.offsetTicks = offsetTicks;
+    return true;
+}
+
+bool qshDirectChannelTsSync::encodeTsOffset(int64_t offsetTicks, uint8_t* buf, size_t bufLen,
+                                            size_t& msgLen)
+{
+    sns_direct_channel_config_msg config = sns_direct_channel_config_msg_init_default;
+    config.which_channel_config_msg_payload = sns_direct_channel_config_msg_set_ts_offset_tag;
+    config.channel_config_msg_payload.set_ts_offset.ts_offset = uint64_t(offsetTicks);
+
+    pb_ostream_t stream = pb_ostream_from_buffer(buf, bufLen);
+    if (!pb_encode(&stream, sns_direct_channel_config_msg_fields, &config)) {
+        sns_loge("failed to encode ts offset, %s", PB_GET_ERROR(&stream));
+        return false;
+    }
+    msgLen = stream.bytes_written;
+    return true;
+}
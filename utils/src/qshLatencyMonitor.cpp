@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include "qshLog.h"
+#include "qshLatencyMonitor.h"
+
+using namespace std;
+
+constexpr size_t qshLatencyMonitor::MAX_SENSORS;
+
+qshLatencyMonitor::qshLatencyMonitor(qshTimeUtil& timeUtil) : mTimeUtil(timeUtil)
+{
+    for (size_t idx = 0; idx < MAX_SENSORS; idx++) {
+        mEntries[idx].store(nullptr, memory_order_relaxed);
+    }
+}
+
+qshLatencyMonitor::~qshLatencyMonitor()
+{
+    for (size_t idx = 0; idx < MAX_SENSORS; idx++) {
+        delete mEntries[idx].load(memory_order_relaxed);
+    }
+}
+
+int qshLatencyMonitor::getHandle(const suid& sensorUid)
+{
+    lock_guard<mutex> lk(mMutex);
+    const int* handle = mHandles.find(sensorUid);
+    if (nullptr != handle) {
+        return *handle;
+    }
+    if (mNumEntries >= MAX_SENSORS) {
+        sns_loge("too many sensors for latency monitoring, suid = [%" PRIx64 " %" PRIx64 "]",
+                 sensorUid.high, sensorUid.low);
+        return -1;
+    }
+    sensorEntry* entry = new sensorEntry();
+    entry->sensorUid = sensorUid;
+    int newHandle = int(mNumEntries++);
+    mEntries[newHandle].store(entry, memory_order_release);
+    mHandles.insert(sensorUid, newHandle);
+    return newHandle;
+}
+
+int qshLatencyMonitor::findHandle(const suid& sensorUid)
+{
+    lock_guard<mutex> lk(mMutex);
+    const int* handle = mHandles.find(sensorUid);
+    return (nullptr != handle) ? *handle : -1;
+}
+
+ISession::eventCallBack qshLatencyMonitor::wrapEventCallBack(const suid& sensorUid,
+                                                             ISession::eventCallBack cb)
+{
+    int handle = getHandle(sensorUid);
+    if (-1 == handle) {
+        return cb;
+    }
+    return [this, handle, cb](const uint8_t* data, size_t size, uint64_t timestamp) {
+        record(handle, timestamp);
+        if (nullptr != cb) {
+            cb(data, size, timestamp);
+        }
+    };
+}
+
+void qshLatencyMonitor::fillSnapshot(sensorEntry& entry, qshLatencySnapshot& snap)
+{
+    /* histogram snapshots are too large for the stack */
+    unique_ptr<qshLatencyHistogram::snapshot> hist = make_unique<qshLatencyHistogram::snapshot>();
+    snap.sensorUid = entry.sensorUid;
+    snap.early = entry.early.load(memory_order_relaxed);
+    entry.latency.getSnapshot(*hist);
+    snap.events = hist->count;
+    snap.minNs = hist->minNs;
+    snap.maxNs = hist->maxNs;
+    snap.meanNs = hist->meanNs();
+    snap.p50Ns = hist->percentileNs(50.0);
+    snap.p99Ns = hist->percentileNs(99.0);
+    snap.p999Ns = hist->percentileNs(99.9);
+    entry.jitter.getSnapshot(*hist);
+    snap.jitterNs = uint64_t(entry.jitter16.load(memory_order_relaxed) >> 4);
+    snap.jitterP99Ns = hist->percentileNs(99.0);
+}
+
+bool qshLatencyMonitor::getSnapshot(int handle, qshLatencySnapshot& snap)
+{
+    if (handle < 0 || size_t(handle) >= MAX_SENSORS) {
+        return false;
+    }
+    sensorEntry* entry = mEntries[handle].load(memory_order_acquire);
+    if (nullptr == entry) {
+        return false;
+    }
+    fillSnapshot(*entry, snap);
+    return true;
+}
+
+vector<qshLatencySnapshot> qshLatencyMonitor::getSnapshots()
+{
+    vector<qshLatencySnapshot> snaps;
+    for (size_t idx = 0; idx < MAX_SENSORS; idx++) {
+        sensorEntry* entry = mEntries[idx].load(memory_order_acquire);
+        if (nullptr == entry) {
+            break;
+        }
+        snaps.emplace_back();
+        fillSnapshot(*entry, snaps.back());
+    }
+    return snaps;
+}
+
+bool qshLatencyMonitor::getHistograms(int handle, qshLatencyHistogram::snapshot& latency,
+                                      qshLatencyHistogram::snapshot& jitter)
+{
+    if (handle < 0 || size_t(handle) >= MAX_SENSORS) {
+        return false;
+    }
+    sensorEntry* entry = mEntries[handle].load(memory_order_acquire);
+    if (nullptr == entry) {
+        return false;
+    }
+    entry->latency.getSnapshot(latency);
+    entry->jitter.getSnapshot(jitter);
+    return true;
+}
+
+void qshLatencyMonitor::reset()
+{
+    for (size_t idx = 0; idx < MAX_SENSORS; idx++) {
+        sensorEntry* entry = mEntries[idx].load(memory_order_acquire);
+        if (nullptr == entry) {
+            break;
+        }
+        entry->latency.reset();
+        entry->jitter.reset();
+        entry->early.store(0, memory_order_relaxed);
+        entry->jitter16.store(0, memory_order_relaxed);
+    }
+}
+
+void qshLatencyMonitor::logStats()
+{
+    for (const qshLatencySnapshot& snap : getSnapshots()) {
+        sns_logi("latency suid = [%" PRIx64 " %" PRIx64 "] events = %" PRIu64
+                 " early = %" PRIu64 " min = %" PRIu64 " mean = %.0f p50 = %" PRIu64
+                 " p99 = %" PRIu64 " p999 = %" PRIu64 " max = %" PRIu64 " jitter = %" PRIu64
+                 " jitter_p99 = %" PRIu64 " ns", snap.sensorUid.high, snap.sensorUid.low,
+                 snap.events, snap.early, snap.minNs, snap.meanNs, snap.p50Ns, snap.p99Ns,
+                 snap.p999Ns, snap.maxNs, snap.jitterNs, snap.jitterP99Ns);
+    }
+}
+
+string qshLatencyMonitor::exportCsv()
+{
+    string csv = "suid,events,early,min_ns,mean_ns,p50_ns,p99_ns,p999_ns,max_ns,"
+                 "jitter_ns,jitter_p99_ns\n";
+    char line[320];
+    for (const qshLatencySnapshot& snap : getSnapshots()) {
+        snprintf(line, sizeof(line), "%016" PRIx64 "%016" PRIx64 ",%" PRIu64 ",%" PRIu64
+                 ",%" PRIu64 ",%.0f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                 ",%" PRIu64 "\n", snap.sensorUid.high, snap.sensorUid.low, snap.events,
+                 snap.early, snap.minNs, snap.meanNs, snap.p50Ns, snap.p99Ns, snap.p999Ns,
+                 snap.maxNs, snap.jitterNs, snap.jitterP99Ns);
+        csv += line;
+    }
+    return csv;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <thread>
+#include <cinttypes>
+#include "qshLog.h"
+#include "qshMultiHub.h"
+
+using namespace std;
+
+qshMultiHub::qshMultiHub()
+{
+    /* resolving the hub IDs also loads the session library, which must
+       happen before sessions are created from several threads */
+    vector<int> hubIds = sessionFactory().getSensingHubIds();
+    if (hubIds.empty()) {
+        sns_logi("hub enumeration not supported, using default hub");
+        hubIds.push_back(-1);
+    }
+    for (int hubId : hubIds) {
+        auto hub = make_unique<hubContext>();
+        hub->hubId = hubId;
+        mHubs.push_back(std::move(hub));
+    }
+}
+
+qshMultiHub::~qshMultiHub()
+{
+    for (auto& hub : mHubs) {
+        if (nullptr != hub->catalog && -1 != hub->subscription) {
+            hub->catalog->unsubscribe(hub->subscription);
+        }
+        if (nullptr != hub->session) {
+            hub->session->close();
+        }
+        /* catalog closes its lookup session on destruction */
+        hub->catalog.reset();
+    }
+}
+
+std::vector<int> qshMultiHub::getHubIds() const
+{
+    vector<int> hubIds;
+    for (const auto& hub : mHubs) {
+        hubIds.push_back(hub->hubId);
+    }
+    return hubIds;
+}
+
+void qshMultiHub::openHub(hubContext& hub)
+{
+    const int hubId = hub.hubId;
+    /* the data session is set up before the catalog, so that it is in
+       place by the time the first suid of this hub becomes routable */
+    hub.factory = make_unique<sessionFactory>();
+    try {
+        hub.session = unique_ptr<ISession>(-1 == hubId ?
+            hub.factory->getSession() : hub.factory->getSession(hubId));
+    } catch (const std::exception& e) {
+        sns_loge("hub %d: exception creating session: %s", hubId, e.what());
+        hub.session = nullptr;
+    } catch (...) {
+        sns_loge("hub %d: unknown exception creating session", hubId);
+        hub.session = nullptr;
+    }
+    if (nullptr == hub.session) {
+        sns_loge("hub %d: failed to create ISession", hubId);
+    } else if (0 != hub.session->open()) {
+        sns_loge("hub %d: failed to open ISession", hubId);
+        hub.session.reset();
+    }
+
+    hub.catalog = make_unique<suidCatalog>(hubId);
+    hub.subscription = hub.catalog->subscribe(
+        [this, hubId](const suidDelta& delta) { this->onDelta(hubId, delta); });
+}
+
+void qshMultiHub::discoverHub(hubContext& hub, const std::vector<std::string>& datatypes,
+    std::chrono::steady_clock::time_point deadline)
+{
+    for (const string& datatype : datatypes) {
+        hub.catalog->track(datatype);
+    }
+    for (const string& datatype : datatypes) {
+        auto now = std::chrono::steady_clock::now();
+        auto remaining = (deadline > now) ?
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) :
+            std::chrono::milliseconds(0);
+        if (!hub.catalog->waitFor(datatype, remaining)) {
+            sns_logi("hub %d: datatype %s not reported", hub.hubId, datatype.c_str());
+        }
+    }
+}
+
+void qshMultiHub::forEachHub(const std::function<void(hubContext&)>& task)
+{
+    vector<thread> workers;
+    for (auto& hub : mHubs) {
+        hubContext* ctx = hub.get();
+        try {
+            workers.emplace_back([&task, ctx]() { task(*ctx); });
+        } catch (const std::exception& e) {
+            /* could not spawn a thread, run the task inline */
+            sns_loge("hub %d: failed to start thread, %s", ctx->hubId, e.what());
+            task(*ctx);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::vector<hubSuid> qshMultiHub::discover(const std::vector<std::string>& datatypes,
+    std::chrono::milliseconds timeoutMs)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeoutMs;
+    {
+        /* only the opening is serialized, the discoveries run
+           concurrently and getSuids() does not wait for them */
+        lock_guard<mutex> lk(mOpenMutex);
+        if (!mOpened) {
+            forEachHub([this](hubContext& hub) { this->openHub(hub); });
+            mOpened = true;
+        }
+    }
+    forEachHub([this, &datatypes, deadline](hubContext& hub) {
+        this->discoverHub(hub, datatypes, deadline);
+    });
+
+    vector<hubSuid> found;
+    for (const string& datatype : datatypes) {
+        vector<hubSuid> suids = getSuids(datatype);
+        found.insert(found.end(), suids.begin(), suids.end());
+    }
+    return found;
+}
+
+std::vector<hubSuid> qshMultiHub::getSuids(const std::string& datatype)
+{
+    vector<hubSuid> found;
+    /* catalogs are created by the first discover() */
+    if (!mOpened) {
+        return found;
+    }
+    for (auto& hub : mHubs) {
+        vector<suid> suids;
+        if (nullptr == hub->catalog || !hub->catalog->getSuids(datatype, suids)) {
+            continue;
+        }
+        for (const suid& uid : suids) {
+            found.push_back(hubSuid{hub->hubId, uid});
+        }
+    }
+    return found;
+}
+
+void qshMultiHub::onDelta(int hubId, const suidDelta& delta)
+{
+    /* a sensor may be listed under several datatypes of its hub: it
+       stays routable until the last of them drops it */
+    lock_guard<mutex> lk(mMutex);
+    for (const suid& uid : delta.removed) {
+        suidOwners* owners = mOwners.find(uid);
+        if (nullptr == owners) {
+            continue;
+        }
+        auto& hubs = owners->hubs;
+        for (auto it = hubs.begin(); it != hubs.end(); ++it) {
+            if (it->first == hubId) {
+                if (0 == --it->second) {
+                    hubs.erase(it);
+                }
+                break;
+            }
+        }
+        if (hubs.empty()) {
+            mOwners.erase(uid);
+        }
+    }
+    for (const suid& uid : delta.added) {
+        auto& hubs = mOwners[uid].hubs;
+        auto it = hubs.begin();
+        while (it != hubs.end() && it->first != hubId) {
+            ++it;
+        }
+        if (it != hubs.end()) {
+            it->second++;
+            continue;
+        }
+        if (!hubs.empty()) {
+            sns_loge("suid = [%" PRIx64 " %" PRIx64 "] reported by hub %d and hub %d",
+                     uid.high, uid.low, hubs.front().first, hubId);
+        }
+        hubs.emplace_back(hubId, 1);
+    }
+}
+
+int qshMultiHub::getOwnerHub(const suid& sensorUid)
+{
+    lock_guard<mutex> lk(mMutex);
+    const suidOwners* owners = mOwners.find(sensorUid);
+    return (nullptr != owners) ? owners->hubs.front().first : -1;
+}
+
+ISession* qshMultiHub::getOwnerSession(const suid& sensorUid)
+{
+    int owner;
+    {
+        lock_guard<mutex> lk(mMutex);
+        const suidOwners* owners = mOwners.find(sensorUid);
+        if (nullptr == owners) {
+            sns_loge("no hub owns suid = [%" PRIx64 " %" PRIx64 "]",
+                     sensorUid.high, sensorUid.low);
+            return nullptr;
+        }
+        owner = owners->hubs.front().first;
+    }
+    for (auto& hub : mHubs) {
+        if (hub->hubId == owner) {
+            if (nullptr == hub->session) {
+                sns_loge("hub %d: session not available", owner);
+            }
+            return hub->session.get();
+        }
+    }
+    return nullptr;
+}
+
+int qshMultiHub::setCallBacks(suid sensorUid, ISession::respCallBack respCB,
+    ISession::errorCallBack errorCB, ISession::eventCallBack eventCB)
+{
+    ISession* session = getOwnerSession(sensorUid);
+    if (nullptr == session) {
+        return -1;
+    }
+    return session->setCallBacks(sensorUid, respCB, errorCB, eventCB);
+}
+
+int qshMultiHub::sendRequest(suid sensorUid, std::string message)
+{
+    ISession* session = getOwnerSession(sensorUid);
+    if (nullptr == session) {
+        return -1;
+    }
+    return session->sendRequest(sensorUid, std::move(message));
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include "qshLog.h"
+#include "qshThreadAttr.h"
+
+static int applyAffinity(pthread_t thread, const std::vector<int>& cpus, const char* name)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            sns_loge("%s: invalid cpu %d in affinity mask", name, cpu);
+            return QSH_THREAD_ATTR_AFFINITY_FAILED;
+        }
+        CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (0 != err) {
+        sns_loge("%s: failed to set cpu affinity, %s", name, strerror(err));
+        return QSH_THREAD_ATTR_AFFINITY_FAILED;
+    }
+    return QSH_THREAD_ATTR_OK;
+#else
+    sns_loge("%s: cpu affinity not supported on this platform", name);
+    return QSH_THREAD_ATTR_AFFINITY_FAILED | QSH_THREAD_ATTR_UNSUPPORTED;
+#endif
+}
+
+static int applySched(pthread_t thread, int policy, int priority, const char* name)
+{
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (SCHED_FIFO == policy || SCHED_RR == policy) {
+        int minPrio = sched_get_priority_min(policy);
+        int maxPrio = sched_get_priority_max(policy);
+        if (priority < minPrio || priority > maxPrio) {
+            sns_loge("%s: priority %d out of range [%d, %d]", name, priority, minPrio, maxPrio);
+            return QSH_THREAD_ATTR_SCHED_FAILED;
+        }
+        param.sched_priority = priority;
+    }
+    int err = pthread_setschedparam(thread, policy, &param);
+    if (0 != err) {
+        sns_loge("%s: failed to set policy %d priority %d, %s", name, policy,
+                 param.sched_priority, strerror(err));
+        return QSH_THREAD_ATTR_SCHED_FAILED;
+    }
+    return QSH_THREAD_ATTR_OK;
+}
+
+static int lockStack(pthread_t thread, size_t bytes, const char* name)
+{
+#ifdef __linux__
+    pthread_attr_t attr;
+    int err = pthread_getattr_np(thread, &attr);
+    if (0 != err) {
+        sns_loge("%s: failed to get stack attributes, %s", name, strerror(err));
+        return QSH_THREAD_ATTR_STACK_LOCK_FAILED;
+    }
+    void* stackAddr = nullptr;
+    size_t stackSize = 0;
+    err = pthread_attr_getstack(&attr, &stackAddr, &stackSize);
+    pthread_attr_destroy(&attr);
+    if (0 != err) {
+        sns_loge("%s: failed to get stack range, %s", name, strerror(err));
+        return QSH_THREAD_ATTR_STACK_LOCK_FAILED;
+    }
+    if (bytes > stackSize) {
+        bytes = stackSize;
+    }
+    /* stacks grow down, lock the part in use first */
+    char* top = static_cast<char*>(stackAddr) + stackSize;
+    if (0 != mlock(top - bytes, bytes)) {
+        sns_loge("%s: failed to lock %zu bytes of stack, %s", name, bytes, strerror(errno));
+        return QSH_THREAD_ATTR_STACK_LOCK_FAILED;
+    }
+    return QSH_THREAD_ATTR_OK;
+#else
+    sns_loge("%s: stack locking not supported on this platform", name);
+    return QSH_THREAD_ATTR_STACK_LOCK_FAILED | QSH_THREAD_ATTR_UNSUPPORTED;
+#endif
+}
+
+int qshApplyThreadAttr(pthread_t thread, const qshThreadAttr& attr, const char* name)
+{
+    if (nullptr == name) {
+        name = "thread";
+    }
+    int failures = QSH_THREAD_ATTR_OK;
+    if (!attr.cpus.empty()) {
+        failures |= applyAffinity(thread, attr.cpus, name);
+    }
+    if (-1 != attr.policy) {
+        failures |= applySched(thread, attr.policy, attr.priority, name);
+    }
+    if (0 != attr.lockStackBytes) {
+        failures |= lockStack(thread, attr.lockStackBytes, name);
+    }
+    if (QSH_THREAD_ATTR_OK == failures) {
+        sns_logd("%s: thread attributes applied", name);
+    }
+    return failures;
+}
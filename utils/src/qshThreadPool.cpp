@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <stdio.h>
+#include "qshLog.h"
+#include "qshThreadPool.h"
+
+using namespace std;
+
+/* pool and queue index of the calling thread, if it is a pool thread */
+static thread_local qshThreadPool* tCurrentPool = nullptr;
+static thread_local size_t tCurrentIndex = 0;
+
+static void runTask(workerInplaceTask& task)
+{
+    try {
+        if (nullptr != task) {
+            task();
+        }
+    } catch (const std::exception& e) {
+        /* if an unhandled exception happened when running
+           the task, just log it and move on */
+        sns_loge("task failed, %s", e.what());
+    }
+}
+
+qshThreadPool::qshThreadPool(size_t numThreads) : mAlive(true)
+{
+    if (0 == numThreads) {
+        numThreads = std::thread::hardware_concurrency();
+    }
+    if (0 == numThreads) {
+        numThreads = 1;
+    }
+    for (size_t idx = 0; idx < numThreads; idx++) {
+        mQueues.push_back(make_unique<taskQueue>());
+    }
+    for (size_t idx = 0; idx < numThreads; idx++) {
+        try {
+            mThreads.emplace_back([this, idx] { run(idx); });
+        } catch (const std::exception& e) {
+            /* queues without a thread are still served by stealing */
+            sns_loge("failed to start pool thread %zu, %s", idx, e.what());
+            break;
+        }
+    }
+    sns_logi("thread pool started with %zu thread(s)", mThreads.size());
+}
+
+qshThreadPool::~qshThreadPool()
+{
+    shutdown();
+}
+
+void qshThreadPool::shutdown()
+{
+    {
+        lock_guard<mutex> lk(mSleepMutex);
+        if (!mAlive) {
+            return;
+        }
+        mAlive = false;
+        mSleepCv.notify_all();
+    }
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+    for (auto& queue : mQueues) {
+        lock_guard<mutex> lk(queue->mutex);
+        queue->tasks.clear();
+    }
+    lock_guard<mutex> lk(mInjection.mutex);
+    mInjection.tasks.clear();
+}
+
+int qshThreadPool::setThreadAttr(const qshThreadAttr& attr, int threadIdx)
+{
+#ifndef _WIN32
+    int failures = QSH_THREAD_ATTR_OK;
+    char name[16];
+    for (size_t idx = 0; idx < mThreads.size(); idx++) {
+        if (-1 != threadIdx && (size_t)threadIdx != idx) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "pool-%zu", idx);
+        failures |= qshApplyThreadAttr(mThreads[idx].native_handle(), attr, name);
+    }
+    return failures;
+#else
+    return QSH_THREAD_ATTR_UNSUPPORTED;
+#endif
+}
+
+bool qshThreadPool::addTask(workerInplaceTask&& task, int affinity)
+{
+    //no task should be enqueued if shutdown has already begun
+    if (!mAlive) {
+        return false;
+    }
+
+    taskQueue* queue = &mInjection;
+    if (affinity >= 0) {
+        queue = mQueues[(size_t)affinity % mQueues.size()].get();
+    } else if (this == tCurrentPool) {
+        queue = mQueues[tCurrentIndex].get();
+    }
+    {
+        lock_guard<mutex> lk(queue->mutex);
+        /* counted before it becomes visible, so that a thread popping
+           it right away never takes mPending below zero */
+        mPending.fetch_add(1);
+        try {
+            queue->tasks.push(std::move(task));
+        } catch (std::exception& e) {
+            mPending.fetch_sub(1);
+            sns_loge("failed to add new task, %s", e.what());
+            return false;
+        }
+    }
+
+    /* a thread about to sleep either sees the new task, or is seen
+       as a sleeper here */
+    if (0 != mSleepers.load()) {
+        lock_guard<mutex> lk(mSleepMutex);
+        mSleepCv.notify_one();
+    }
+    return true;
+}
+
+bool qshThreadPool::popFrom(taskQueue& queue, workerInplaceTask& task)
+{
+    lock_guard<mutex> lk(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.pop();
+    mPending.fetch_sub(1);
+    return true;
+}
+
+bool qshThreadPool::takeTask(size_t index, workerInplaceTask& task)
+{
+    if (popFrom(*mQueues[index], task) || popFrom(mInjection, task)) {
+        return true;
+    }
+    for (size_t step = 1; step < mQueues.size(); step++) {
+        if (popFrom(*mQueues[(index + step) % mQueues.size()], task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* pool thread's mainloop */
+void qshThreadPool::run(size_t index)
+{
+    tCurrentPool = this;
+    tCurrentIndex = index;
+
+    workerInplaceTask task;
+    while (mAlive) {
+        if (takeTask(index, task)) {
+            runTask(task);
+            task = nullptr;
+            continue;
+        }
+        unique_lock<mutex> lk(mSleepMutex);
+        mSleepers.fetch_add(1);
+        while (mAlive && 0 == mPending.load()) {
+            mSleepCv.wait(lk);
+        }
+        mSleepers.fetch_sub(1);
+    }
+}
+
+qshPoolWorker::qshPoolWorker(qshThreadPool& pool, int affinity)
+    : mPool(pool), mAffinity(affinity), mStrand(make_shared<strand>())
+{
+}
+
+qshPoolWorker::~qshPoolWorker()
+{
+    shutdownWorker();
+}
+
+void qshPoolWorker::shutdownWorker()
+{
+    unique_lock<mutex> lk(mStrand->mutex);
+    if (!mStrand->alive) {
+        return;
+    }
+    mStrand->alive = false;
+    while (mStrand->running) {
+        mStrand->idle.wait(lk);
+    }
+    mStrand->tasks.clear();
+}
+
+void qshPoolWorker::setName(const char *name)
+{
+    lock_guard<mutex> lk(mStrand->mutex);
+    snprintf(mStrand->name, sizeof(mStrand->name), "%s", name);
+}
+
+void qshPoolWorker::addTask(workerInplaceTask&& task)
+{
+    {
+        lock_guard<mutex> lk(mStrand->mutex);
+        //no task should be enqueued if shutdown has already begun
+        if (!mStrand->alive) {
+            return;
+        }
+        try {
+            mStrand->tasks.push(std::move(task));
+        } catch (std::exception& e) {
+            sns_loge("%s: failed to add new task, %s", mStrand->name, e.what());
+            return;
+        }
+        if (mStrand->scheduled) {
+            /* already queued on the pool, it will pick this task up */
+            return;
+        }
+        mStrand->scheduled = true;
+    }
+    schedule(&mPool, mAffinity, mStrand);
+}
+
+void qshPoolWorker::schedule(qshThreadPool* pool, int affinity, const std::shared_ptr<strand>& s)
+{
+    bool queued = pool->addTask([pool, affinity, s]() { drain(pool, affinity, s); }, affinity);
+    if (!queued) {
+        lock_guard<mutex> lk(s->mutex);
+        sns_loge("%s: pool is shutting down, tasks dropped", s->name);
+        s->scheduled = false;
+        s->tasks.clear();
+    }
+}
+
+void qshPoolWorker::drain(qshThreadPool* pool, int affinity, const std::shared_ptr<strand>& s)
+{
+    unique_lock<mutex> lk(s->mutex);
+    s->running = true;
+    for (int count = 0; count < DRAIN_BATCH && s->alive && !s->tasks.empty(); count++) {
+        workerInplaceTask task = s->tasks.pop();
+        lk.unlock();
+        runTask(task);
+        task = nullptr;
+        lk.lock();
+    }
+    s->running = false;
+    s->idle.notify_all();
+
+    if (s->alive && !s->tasks.empty()) {
+        /* yield the pool thread to other work, keep the order by
+           leaving the strand scheduled */
+        lk.unlock();
+        schedule(pool, affinity, s);
+        return;
+    }
+    s->scheduled = false;
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <algorithm>
+#include <cinttypes>
+#include "qshLog.h"
+#include "suidCatalog.h"
+
+using namespace std;
+
+/* returns the suids of 'from' which are not part of 'to' */
+static vector<suid> suidDifference(const vector<suid>& from, const vector<suid>& to)
+{
+    vector<suid> diff;
+    for (const suid& uid : from) {
+        if (std::find(to.begin(), to.end(), uid) == to.end()) {
+            diff.push_back(uid);
+        }
+    }
+    return diff;
+}
+
+suidCatalog::suidCatalog(int hubId)
+    : mHubId(hubId)
+{
+    mLookUp = make_unique<suidLookUp>(
+        [this](const std::string& datatype, const vector<suid>& suids)
+        {
+            this->onSuidEvent(datatype, suids);
+        },
+        hubId,
+        [this]()
+        {
+            this->onDiscoveryDone();
+        });
+}
+
+suidCatalog::~suidCatalog()
+{
+    /* close the sessions before the catalog state goes away */
+    mDefaultLookUp.reset();
+    mLookUp.reset();
+}
+
+std::shared_ptr<suidCatalog> suidCatalog::getShared(int hubId)
+{
+    static std::mutex sharedMutex;
+    static std::map<int, std::shared_ptr<suidCatalog>> sharedCatalogs;
+
+    lock_guard<mutex> lk(sharedMutex);
+    auto it = sharedCatalogs.find(hubId);
+    if (it != sharedCatalogs.end()) {
+        return it->second;
+    }
+    auto catalog = make_shared<suidCatalog>(hubId);
+    sharedCatalogs.emplace(hubId, catalog);
+    return catalog;
+}
+
+suidLookUp& suidCatalog::getDefaultLookUp()
+{
+    /* the hub does not tell which registration an suid event answers,
+       so default-only requests get a session of their own */
+    std::call_once(mDefaultLookUpOnce, [this]() {
+        mDefaultLookUp = make_unique<suidLookUp>(
+            [this](const std::string& datatype, const vector<suid>& suids)
+            {
+                this->onDefaultSuidEvent(datatype, suids);
+            },
+            mHubId,
+            [this]()
+            {
+                this->onDiscoveryDone();
+            });
+    });
+    return *mDefaultLookUp;
+}
+
+bool suidCatalog::track(const std::string& datatype, bool defaultOnly)
+{
+    auto& entries = defaultOnly ? mDefaults : mCatalog;
+    {
+        lock_guard<mutex> lk(mMutex);
+        if (entries.find(datatype) != entries.end()) {
+            return true;
+        }
+        catalogEntry entry;
+        entry.requestTime = std::chrono::steady_clock::now();
+        entries.emplace(datatype, std::move(entry));
+    }
+    sns_logd("catalog(hub %d): tracking datatype %s%s", mHubId, datatype.c_str(),
+             defaultOnly ? " (default only)" : "");
+    int ret = defaultOnly ? getDefaultLookUp().requestSuid(datatype, true) :
+                            mLookUp->requestSuid(datatype, false);
+    if (0 == ret) {
+        return true;
+    }
+
+    sns_loge("catalog(hub %d): failed to request datatype %s", mHubId, datatype.c_str());
+    /* forget the request so that the next track() sends it again */
+    lock_guard<mutex> lk(mMutex);
+    auto it = entries.find(datatype);
+    if (it != entries.end() && !it->second.known) {
+        entries.erase(it);
+    }
+    mConditionVar.notify_all();
+    return false;
+}
+
+bool suidCatalog::lookUpDefault(const std::string& datatype, suid& sensorUid,
+    std::chrono::milliseconds timeoutMs)
+{
+    {
+        lock_guard<mutex> lk(mMutex);
+        if (isAbsentLocked(datatype)) {
+            return false;
+        }
+        auto it = mDefaults.find(datatype);
+        if (it != mDefaults.end() && it->second.known && !it->second.suids.empty()) {
+            sensorUid = it->second.suids.front();
+            return true;
+        }
+    }
+
+    if (!track(datatype, true) || !waitForEntry(mDefaults, datatype, timeoutMs)) {
+        return false;
+    }
+
+    lock_guard<mutex> lk(mMutex);
+    const catalogEntry& entry = mDefaults[datatype];
+    if (entry.suids.empty()) {
+        return false;
+    }
+    sensorUid = entry.suids.front();
+    return true;
+}
+
+bool suidCatalog::isAbsentLocked(const std::string& datatype)
+{
+    /* absence is a property of the hub, whichever request found it */
+    auto it = mCatalog.find(datatype);
+    if (it != mCatalog.end() && it->second.absent) {
+        return true;
+    }
+    it = mDefaults.find(datatype);
+    return (it != mDefaults.end() && it->second.absent);
+}
+
+bool suidCatalog::isAbsent(const std::string& datatype)
+{
+    lock_guard<mutex> lk(mMutex);
+    return isAbsentLocked(datatype);
+}
+
+bool suidCatalog::getSuids(const std::string& datatype, std::vector<suid>& suids)
+{
+    lock_guard<mutex> lk(mMutex);
+    auto it = mCatalog.find(datatype);
+    if (it == mCatalog.end() || !it->second.known) {
+        suids.clear();
+        return false;
+    }
+    suids = it->second.suids;
+    return true;
+}
+
+std::vector<std::string> suidCatalog::getDataTypes()
+{
+    lock_guard<mutex> lk(mMutex);
+    vector<string> datatypes;
+    for (const auto& entry : mCatalog) {
+        if (entry.second.known) {
+            datatypes.push_back(entry.first);
+        }
+    }
+    return datatypes;
+}
+
+bool suidCatalog::waitFor(const std::string& datatype, std::chrono::milliseconds timeoutMs)
+{
+    return waitForEntry(mCatalog, datatype, timeoutMs);
+}
+
+bool suidCatalog::waitForEntry(std::map<std::string, catalogEntry>& entries,
+    const std::string& datatype, std::chrono::milliseconds timeoutMs)
+{
+    const auto then = std::chrono::steady_clock::now() + timeoutMs;
+    unique_lock<mutex> lk(mMutex);
+    while (true) {
+        auto it = entries.find(datatype);
+        if (it != entries.end() && it->second.known) {
+            return true;
+        }
+        if (isAbsentLocked(datatype)) {
+            return false;
+        }
+
+        /* after discovery done, the hub answers right away for sensors it
+           has; no answer within the grace period means the datatype is absent */
+        auto deadline = then;
+        bool graceDeadline = false;
+        if (mDiscoveryDone && it != entries.end() &&
+            it->second.requestTime + ABSENT_GRACE_PERIOD < then) {
+            deadline = it->second.requestTime + ABSENT_GRACE_PERIOD;
+            graceDeadline = true;
+        }
+        if (mConditionVar.wait_until(lk, deadline) == std::cv_status::timeout) {
+            it = entries.find(datatype);
+            if (it != entries.end() && it->second.known) {
+                return true;
+            }
+            if (graceDeadline && it != entries.end()) {
+                sns_logi("catalog(hub %d): datatype %s is absent", mHubId, datatype.c_str());
+                it->second.absent = true;
+                return false;
+            }
+            sns_logi("catalog(hub %d): timeout(%lld ms) waiting for datatype %s",
+                     mHubId, (long long)timeoutMs.count(), datatype.c_str());
+            return false;
+        }
+    }
+}
+
+bool suidCatalog::isDiscoveryDone()
+{
+    lock_guard<mutex> lk(mMutex);
+    return mDiscoveryDone;
+}
+
+int suidCatalog::subscribe(suidDeltaCb cb)
+{
+    auto subscriber = make_shared<suidDeltaCb>(std::move(cb));
+    vector<suidDelta> replay;
+    int handle;
+    /* no delta can be applied or delivered until the replay is done,
+       so the subscriber sees the replay first and every later change
+       exactly once */
+    lock_guard<mutex> dispatchLk(mDispatchMutex);
+    {
+        lock_guard<mutex> lk(mMutex);
+        handle = mNextHandle++;
+        mSubscribers.emplace(handle, subscriber);
+        for (const auto& entry : mCatalog) {
+            if (entry.second.known && !entry.second.suids.empty()) {
+                replay.push_back(suidDelta{entry.first, entry.second.suids, {}});
+            }
+        }
+    }
+    for (const suidDelta& delta : replay) {
+        (*subscriber)(delta);
+    }
+    return handle;
+}
+
+void suidCatalog::unsubscribe(int handle)
+{
+    lock_guard<mutex> lk(mMutex);
+    mSubscribers.erase(handle);
+}
+
+void suidCatalog::notify(const suidDelta& delta)
+{
+    vector<shared_ptr<suidDeltaCb>> subscribers;
+    {
+        lock_guard<mutex> lk(mMutex);
+        for (const auto& subscriber : mSubscribers) {
+            subscribers.push_back(subscriber.second);
+        }
+    }
+    for (const auto& subscriber : subscribers) {
+        (*subscriber)(delta);
+    }
+}
+
+void suidCatalog::onDefaultSuidEvent(const std::string& datatype, const std::vector<suid>& suids)
+{
+    lock_guard<mutex> lk(mMutex);
+    catalogEntry& entry = mDefaults[datatype];
+    entry.suids = suids;
+    entry.known = true;
+    entry.absent = suids.empty();
+    mConditionVar.notify_all();
+}
+
+void suidCatalog::onSuidEvent(const std::string& datatype, const std::vector<suid>& suids)
+{
+    suidDelta delta;
+    /* apply and deliver the delta as one step with respect to subscribe() */
+    lock_guard<mutex> dispatchLk(mDispatchMutex);
+    {
+        lock_guard<mutex> lk(mMutex);
+        catalogEntry& entry = mCatalog[datatype];
+        delta.datatype = datatype;
+        delta.added = suidDifference(suids, entry.suids);
+        delta.removed = suidDifference(entry.suids, suids);
+        entry.suids = suids;
+        entry.known = true;
+        entry.absent = suids.empty();
+        mConditionVar.notify_all();
+    }
+
+    sns_logi("catalog(hub %d): datatype %s, %zu suid(s), +%zu -%zu", mHubId,
+             datatype.c_str(), suids.size(), delta.added.size(), delta.removed.size());
+    if (!delta.added.empty() || !delta.removed.empty()) {
+        notify(delta);
+    }
+}
+
+void suidCatalog::onDiscoveryDone()
+{
+    lock_guard<mutex> lk(mMutex);
+    if (mDiscoveryDone) {
+        /* sent again to every session opened afterwards */
+        return;
+    }
+    sns_logi("catalog(hub %d): discovery done", mHubId);
+    mDiscoveryDone = true;
+    /* every sensor has been published by now: datatypes requested
+       long enough ago and still not reported are not available on
+       this hub. Later requests get their grace period in waitFor(),
+       as done is also sent right away to a fresh session. */
+    const auto now = std::chrono::steady_clock::now();
+    for (auto* entries : {&mCatalog, &mDefaults}) {
+        for (auto& entry : *entries) {
+            if (!entry.second.known && entry.second.requestTime + ABSENT_GRACE_PERIOD <= now) {
+                entry.second.absent = true;
+            }
+        }
+    }
+    mConditionVar.notify_all();
+}
@@ -12,6 +12,7 @@
 #include "sns_suid.pb.h"
 #include "qshLog.h"
 #include "suidLookUp.h"
+#include "suidCatalog.h"
 
 using namespace std;
 using namespace std::chrono;
@@ -21,8 +22,8 @@ struct suid_decode_context {
     std::vector<std::string> *datatype;
 };
 
-suidLookUp::suidLookUp(suidEventCb cb, int hubID)
-  : mEventCb(cb)
+suidLookUp::suidLookUp(suidEventCb cb, int hubID, suidDiscoveryDoneCb doneCb)
+  : mEventCb(cb), mDoneCb(doneCb)
 {
   mSensorUid.low = 12370169555311111083ull;
   mSensorUid.high = 12370169555311111083ull;
@@ -73,7 +74,7 @@ suidLookUp::~suidLookUp() {
     mSession->close();
   }
 }
-void suidLookUp::requestSuid(std::string datatype, bool default_only)
+int suidLookUp::requestSuid(std::string datatype, bool default_only)
 {
     pb_byte_t encoded_payload[100];
     sns_logv("requesting suid for %s, ts = %fs", datatype.c_str(),
@@ -97,7 +98,7 @@ void suidLookUp::requestSuid(std::string datatype, bool default_only)
 
     if (!pb_encode(&payload_stream, sns_suid_req_fields, &suid_req)) {
       sns_loge("lookup: sns_suid_req encoding failed: %s", PB_GET_ERROR(&payload_stream));
-      return;
+      return -1;
     }
     sns_logd("lookup: Encoded %zu bytes successfully", payload_stream.bytes_written);
 
@@ -122,18 +123,21 @@ void suidLookUp::requestSuid(std::string datatype, bool default_only)
     pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
     if (!pb_encode(&stream, sns_client_request_msg_fields, &request_msg)) {
         sns_loge("lookup: Failed to encode sns_client_request: %s\n", PB_GET_ERROR(&stream));
-        return;
+        return -1;
     }
     sns_logd("lookup: Encoded sns_client_request successfully (%zu bytes)\n", stream.bytes_written);
     std::string encoded_string(reinterpret_cast<char*>(buffer), stream.bytes_written);
 
-    if (nullptr != mSession){
-      int ret = mSession->sendRequest(mSensorUid, encoded_string);
-      if(0 != ret){
-        sns_loge("Error in sending request");
-        return;
-      }
+    if (nullptr == mSession){
+      sns_loge("lookup: no session to send the request");
+      return -1;
+    }
+    int ret = mSession->sendRequest(mSensorUid, encoded_string);
+    if(0 != ret){
+      sns_loge("Error in sending request");
+      return -1;
     }
+    return 0;
 }
 
 bool suid_decode_event(pb_istream_t *stream, const pb_field_t *field,
@@ -243,9 +247,12 @@ void suidLookUp::handleQshEvent(const uint8_t *data, size_t size, uint64_t timeS
     }
     /* send callback for this datatype */
     if(suids_vector.size() == datatype_vector.size() && datatype_vector.size() != 0){
-      for(size_t i=0;i<datatype_vector.size();i++)
+      for(size_t i=0;i<datatype_vector.size();i++) {
         if(datatype_vector[i] != "SNS_SUID_MSGID_SNS_SUID_DISCOVERY_DONE_EVENT")
           mEventCb(datatype_vector[i], suids_vector[i]);
+        else if(nullptr != mDoneCb)
+          mDoneCb();
+      }
     } else {
       sns_loge("lookup: sns_client_event events mismatch");
     }
@@ -289,6 +296,20 @@ void locate::onSuidsAvailable(const std::string& datatype, const std::vector<sui
     }
 }
 
+void locate::onDiscoveryDone()
+{
+    unique_lock<mutex> lk(mMutex);
+    mDiscoveryDone = true;
+    mDiscoveryDoneTime = std::chrono::steady_clock::now();
+    mConditionVar.notify_one();
+}
+
+bool locate::lookUpDefault(const std::string& datatype, suid& sensorUid, int hubId,
+    std::chrono::milliseconds timeoutMs)
+{
+    return suidCatalog::getShared(hubId)->lookUpDefault(datatype, sensorUid, timeoutMs);
+}
+
 std::shared_ptr<std::vector<suid>> locate::lookUp(const std::string& dataType, int hubId, std::chrono::milliseconds timeoutMs)
 {
     if (!mSuids)
@@ -305,18 +326,36 @@ std::shared_ptr<std::vector<suid>> locate::lookUp(const std::string& dataType, i
         [this](const auto& dataType, const vector<suid>& suids)
         {
             this->onSuidsAvailable(dataType, suids);
-        }, hubId);
+        }, hubId,
+        [this]()
+        {
+            this->onDiscoveryDone();
+        });
 
     lookup.requestSuid(dataType);
 
     sns_logi("waiting for suid lookup");
     // TODO remove timeout once suid_lookup request_suid() is fixed
-    const auto then = std::chrono::system_clock::now() + timeoutMs;
+    const auto then = std::chrono::steady_clock::now() + timeoutMs;
 
     unique_lock<mutex> lk(mMutex);
     while (!mLookupDone) {
-        if (mConditionVar.wait_until(lk, then) == std::cv_status::timeout) {
-            sns_logi("SUID lookup timeout(%lld ms) for datatype %s.", timeoutMs.count(), dataType.c_str());
+        /* suid events may be sent several times as sensors become
+           available: the list is final once discovery is done and
+           the events following it had a grace period to arrive */
+        auto deadline = then;
+        if (mDiscoveryDone && mDiscoveryDoneTime + DISCOVERY_DONE_GRACE_PERIOD < then) {
+            deadline = mDiscoveryDoneTime + DISCOVERY_DONE_GRACE_PERIOD;
+        }
+        if (mConditionVar.wait_until(lk, deadline) == std::cv_status::timeout) {
+            if (deadline != then) {
+                if (mSuids->empty()) {
+                    sns_logi("datatype %s not available after discovery done", dataType.c_str());
+                }
+                mLookupDone = true;
+            } else {
+                sns_logi("SUID lookup timeout(%lld ms) for datatype %s.", (long long)timeoutMs.count(), dataType.c_str());
+            }
             break;
         }
     }
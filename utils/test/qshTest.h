@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#pragma once
+#include <cstdio>
+
+/**
+ * Minimal checks for the unit tests of qshUtil. Each test is a
+ * program of its own: a failed check is reported and counted, and
+ * QSH_TEST_RESULT() turns the count into the exit status.
+ */
+static int qshTestFailures = 0;
+
+#define QSH_CHECK(cond)                                                             \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            qshTestFailures++;                                                      \
+        }                                                                           \
+    } while (0)
+
+#define QSH_TEST_RESULT()                                                           \
+    ((0 == qshTestFailures) ? 0 : (fprintf(stderr, "%d check(s) failed\n",           \
+                                           qshTestFailures), 1))
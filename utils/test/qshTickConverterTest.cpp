@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cstdint>
+#include <vector>
+#include "qshTickConverter.h"
+#include "qshTest.h"
+
+using namespace std;
+
+/* floor(value * toFreq / fromFreq), wrapped to 64 bits */
+static constexpr uint64_t reference(uint64_t value, uint64_t fromFreq, uint64_t toFreq)
+{
+    return uint64_t((unsigned __int128)value * toFreq / fromFreq);
+}
+
+/* QTimer ticks to ns, folded at build time */
+static_assert(qshTickConverter(19200000, 1000000000).convert(UINT64_MAX) ==
+              reference(UINT64_MAX, 19200000, 1000000000), "ticks to ns at 2^64-1");
+static_assert(qshTickConverter(1000000000, 19200000).convert(UINT64_MAX) ==
+              reference(UINT64_MAX, 1000000000, 19200000), "ns to ticks at 2^64-1");
+
+static void testExact()
+{
+    const uint64_t freqs[][2] = {
+        {19200000, 1000000000},     /* QTimer ticks to ns */
+        {1000000000, 19200000},
+        {1000000000, 1000000000},
+        {3, 7},
+        {7, 3},
+        {1, UINT64_MAX},
+        {UINT64_MAX, 1},
+        {UINT64_MAX, UINT64_MAX - 1},
+        {UINT64_MAX - 1, UINT64_MAX},
+        {1000000007, 998244353},
+    };
+    for (const auto& freq : freqs) {
+        const uint64_t from = freq[0];
+        const uint64_t to = freq[1];
+        const qshTickConverter conv(from, to);
+
+        vector<uint64_t> values = {0, 1, 2, from - 1, from, from + 1, UINT64_MAX / 2,
+                                   UINT64_MAX / 2 + 1, UINT64_MAX - from, UINT64_MAX - 1,
+                                   UINT64_MAX};
+        /* and values spread over the whole range */
+        uint64_t lcg = from ^ to;
+        for (int idx = 0; idx < 1000; idx++) {
+            lcg = lcg * 6364136223846793005ull + 1442695040888963407ull;
+            values.push_back(lcg >> (idx % 64));
+        }
+
+        vector<uint64_t> out(values.size());
+        conv.convert(values.data(), out.data(), values.size());
+        for (size_t idx = 0; idx < values.size(); idx++) {
+            const uint64_t expected = reference(values[idx], from, to);
+            QSH_CHECK(conv.convert(values[idx]) == expected);
+            QSH_CHECK(out[idx] == expected);
+        }
+    }
+}
+
+/* converting in place gives the same result */
+static void testInPlace()
+{
+    const qshTickConverter conv(19200000, 1000000000);
+    vector<uint64_t> values = {0, 1, 19199999, 19200000, UINT64_MAX - 1, UINT64_MAX};
+    const vector<uint64_t> in = values;
+    conv.convert(values.data(), values.data(), values.size());
+    for (size_t idx = 0; idx < in.size(); idx++) {
+        QSH_CHECK(values[idx] == reference(in[idx], 19200000, 1000000000));
+    }
+}
+
+int main()
+{
+    testExact();
+    testInPlace();
+    return QSH_TEST_RESULT();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <initializer_list>
+#include "qshTimeMapper.h"
+#include "qshTest.h"
+
+static constexpr uint64_t SEC = 1000000000ull;
+static constexpr int64_t OFFSET = 1000;
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9;
+}
+
+/* a mapper with one sample, mapping source + OFFSET */
+static void start(qshTimeMapper& mapper)
+{
+    QSH_CHECK(mapper.addSample(SEC, int64_t(SEC) + OFFSET, SEC));
+    QSH_CHECK(mapper.toTarget(SEC) == int64_t(SEC) + OFFSET);
+}
+
+/* errors up to the threshold are slewed, on both sides */
+static void testSlewAtThreshold()
+{
+    for (int64_t error : {qshTimeMapper::STEP_THRESHOLD_NS, -qshTimeMapper::STEP_THRESHOLD_NS}) {
+        qshTimeMapper mapper;
+        start(mapper);
+        const int64_t before = mapper.toTarget(2 * SEC);
+        QSH_CHECK(!mapper.addSample(2 * SEC, int64_t(2 * SEC) + OFFSET + error, SEC));
+
+        /* the mapping is continuous, the error goes to the slope */
+        QSH_CHECK(mapper.toTarget(2 * SEC) == before);
+        QSH_CHECK(mapper.get().offsetNs == OFFSET);
+        QSH_CHECK(near(mapper.getRate(), double(error) / double(SEC)));
+        const double slew = mapper.get().slope - mapper.getRate();
+        QSH_CHECK(near(slew, error > 0 ? qshTimeMapper::MAX_SLEW : -qshTimeMapper::MAX_SLEW));
+    }
+}
+
+/* errors past the threshold are stepped, on both sides */
+static void testStepPastThreshold()
+{
+    for (int64_t error : {qshTimeMapper::STEP_THRESHOLD_NS + 1,
+                          -qshTimeMapper::STEP_THRESHOLD_NS - 1}) {
+        qshTimeMapper mapper;
+        start(mapper);
+        const int64_t target = int64_t(2 * SEC) + OFFSET + error;
+        QSH_CHECK(mapper.addSample(2 * SEC, target, SEC));
+
+        /* the new offset applies right away, the drift starts over */
+        QSH_CHECK(mapper.toTarget(2 * SEC) == target);
+        QSH_CHECK(mapper.get().slope == 0.0);
+        QSH_CHECK(mapper.getRate() == 0.0);
+        QSH_CHECK(mapper.getResidualNs() == 0.0);
+    }
+}
+
+/* small errors are slewed over the given period, unclamped */
+static void testSlewPeriod()
+{
+    qshTimeMapper mapper;
+    start(mapper);
+    /* 1 us off after 1 s, absorbed over 10 s */
+    QSH_CHECK(!mapper.addSample(2 * SEC, int64_t(2 * SEC) + OFFSET + 1000, 10 * SEC));
+    QSH_CHECK(near(mapper.getRate(), 1e-6));
+    QSH_CHECK(near(mapper.get().slope - mapper.getRate(), 1e-7));
+
+    /* converted timestamps stay monotonic across the update */
+    QSH_CHECK(mapper.toTarget(2 * SEC + 1) > mapper.toTarget(2 * SEC));
+    QSH_CHECK(std::llabs(int64_t(mapper.toSource(mapper.toTarget(3 * SEC)) - 3 * SEC)) <= 1);
+}
+
+/* reset() and the first sample always step */
+static void testReset()
+{
+    qshTimeMapper mapper;
+    start(mapper);
+    QSH_CHECK(!mapper.addSample(2 * SEC, int64_t(2 * SEC) + OFFSET + 10, SEC));
+    mapper.reset(3 * SEC, int64_t(3 * SEC) + OFFSET + 10);
+    QSH_CHECK(mapper.toTarget(3 * SEC) == int64_t(3 * SEC) + OFFSET + 10);
+    QSH_CHECK(mapper.get().slope == 0.0);
+}
+
+int main()
+{
+    testSlewAtThreshold();
+    testStepPastThreshold();
+    testSlewPeriod();
+    testReset();
+    return QSH_TEST_RESULT();
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Qualcomm Technologies, Inc. and/or its subsidiaries.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "qshTimerWheel.h"
+#include "qshTest.h"
+
+using namespace std;
+using namespace std::chrono;
+
+using wheel = qshTimerWheel<function<void()>>;
+
+/*
+ * Drives a wheel in virtual time. The wheel counts ticks from its
+ * construction, which is slightly before t0: timers are scheduled half
+ * a tick early so they land exactly on tick k, and the wheel is moved
+ * to the start of tick k.
+ */
+struct virtualWheel {
+    static constexpr milliseconds TICK = milliseconds(10);
+
+    wheel w{TICK};
+    const wheel::clock::time_point t0 = wheel::clock::now();
+    vector<wheel::firedTimer> fired;
+
+    wheel::clock::time_point at(uint64_t tick) const { return t0 + TICK * tick; }
+
+    qshTimerId schedule(uint64_t tick, uint64_t periodTicks = 0)
+    {
+        return w.schedule(at(tick) - TICK / 2, [] {}, TICK * periodTicks);
+    }
+
+    /* ids fired when moving the wheel to the given tick */
+    vector<qshTimerId> expire(uint64_t tick)
+    {
+        fired.clear();
+        w.expire(at(tick), fired);
+        vector<qshTimerId> ids;
+        for (const auto& timer : fired) {
+            ids.push_back(timer.id);
+        }
+        return ids;
+    }
+};
+
+constexpr milliseconds virtualWheel::TICK;
+
+/* timers on both sides of each level boundary fire on their tick */
+static void testLevelBoundaries()
+{
+    const vector<uint64_t> ticks = {1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+                                    16777216, 1073741823, 1073741824, 1073741825};
+    virtualWheel vw;
+    vector<qshTimerId> ids;
+    for (uint64_t tick : ticks) {
+        ids.push_back(vw.schedule(tick));
+    }
+    QSH_CHECK(vw.w.size() == ticks.size());
+
+    for (size_t idx = 0; idx < ticks.size(); idx++) {
+        QSH_CHECK(vw.expire(ticks[idx] - 1).empty());
+        vector<qshTimerId> fired = vw.expire(ticks[idx]);
+        QSH_CHECK(fired.size() == 1 && fired[0] == ids[idx]);
+    }
+    QSH_CHECK(vw.w.empty());
+    QSH_CHECK(vw.w.nextDeadline() == wheel::clock::time_point::max());
+}
+
+/* one large step fires everything, in due order */
+static void testExpireInOrder()
+{
+    const vector<uint64_t> ticks = {4097, 1, 262144, 64, 65, 63, 4096};
+    virtualWheel vw;
+    vector<pair<uint64_t, qshTimerId>> expected;
+    for (uint64_t tick : ticks) {
+        expected.emplace_back(tick, vw.schedule(tick));
+    }
+    sort(expected.begin(), expected.end());
+
+    vector<qshTimerId> fired = vw.expire(262144);
+    QSH_CHECK(fired.size() == expected.size());
+    for (size_t idx = 0; idx < fired.size() && idx < expected.size(); idx++) {
+        QSH_CHECK(fired[idx] == expected[idx].second);
+    }
+}
+
+/* timers cancelled from the task of another timer, or while firing */
+static void testCancelDuringFire()
+{
+    virtualWheel vw;
+    qshTimerId oneShot = vw.schedule(5);
+    qshTimerId sameTick = vw.schedule(5);
+    qshTimerId later = vw.schedule(6);
+    qshTimerId periodic = vw.schedule(5, 10);
+
+    vector<qshTimerId> fired = vw.expire(5);
+    QSH_CHECK(fired.size() == 3);
+    QSH_CHECK(vw.w.size() == 2);
+
+    /* as done by the task of oneShot: one-shot timers of the same
+       batch are already gone, pending and firing ones are cancelled */
+    QSH_CHECK(!vw.w.cancel(sameTick));
+    QSH_CHECK(vw.w.cancel(later));
+    QSH_CHECK(vw.w.cancel(periodic));
+    QSH_CHECK(!vw.w.cancel(periodic));
+    QSH_CHECK(!vw.w.cancel(oneShot));
+    QSH_CHECK(vw.w.empty());
+
+    /* handing the cancelled periodic timer back does not re-arm it */
+    for (auto& timer : vw.fired) {
+        if (timer.periodic) {
+            vw.w.rearm(timer.id, std::move(timer.task));
+        }
+    }
+    QSH_CHECK(vw.expire(100).empty());
+    QSH_CHECK(vw.w.empty());
+
+    /* its node is reused under a new id, the old one stays dead */
+    qshTimerId reused = vw.schedule(110);
+    QSH_CHECK(reused != periodic);
+    QSH_CHECK(!vw.w.cancel(periodic));
+    QSH_CHECK(vw.w.cancel(reused));
+}
+
+/* a periodic timer rearmed late skips the periods it missed */
+static void testPeriodicRearm()
+{
+    virtualWheel vw;
+    qshTimerId id = vw.schedule(10, 10);
+
+    /* on time: every period */
+    for (uint64_t tick = 10; tick <= 30; tick += 10) {
+        QSH_CHECK(vw.expire(tick - 1).empty());
+        vector<qshTimerId> fired = vw.expire(tick);
+        QSH_CHECK(fired.size() == 1 && fired[0] == id && vw.fired[0].periodic);
+        vw.w.rearm(id, std::move(vw.fired[0].task));
+    }
+
+    /* the task of tick 40 runs until tick 67: ticks 50 and 60 are
+       missed, the timer is due again at 70, once */
+    QSH_CHECK(vw.expire(40).size() == 1);
+    function<void()> task = std::move(vw.fired[0].task);
+    QSH_CHECK(vw.expire(67).empty());
+    vw.w.rearm(id, std::move(task));
+    QSH_CHECK(vw.w.nextDeadline() <= vw.at(70));
+    QSH_CHECK(vw.expire(69).empty());
+    vector<qshTimerId> fired = vw.expire(70);
+    QSH_CHECK(fired.size() == 1 && fired[0] == id);
+
+    /* rearmed on its next due tick: that period counts as missed */
+    task = std::move(vw.fired[0].task);
+    QSH_CHECK(vw.expire(80).empty());
+    vw.w.rearm(id, std::move(task));
+    QSH_CHECK(vw.expire(89).empty());
+    QSH_CHECK(vw.expire(90).size() == 1);
+    vw.w.rearm(id, std::move(vw.fired[0].task));
+    QSH_CHECK(vw.w.cancel(id));
+    QSH_CHECK(vw.w.empty());
+}
+
+int main()
+{
+    testLevelBoundaries();
+    testExpireInOrder();
+    testCancelDuringFire();
+    testPeriodicRearm();
+    return QSH_TEST_RESULT();
+}